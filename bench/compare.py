@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Runs the binding benchmark harnesses and compares them with native Rust.
+
+Every harness runs the workload described in
+cdb64/examples/bindings_workload.rs and prints JSON lines of the form
+{"lang": ..., "op": ..., "records": ..., "ns_per_op": ...}.
+
+    python3 bench/compare.py                 # run every harness
+    python3 bench/compare.py --only rust,c   # run a subset
+    python3 bench/compare.py results/*.jsonl # compare previously saved output
+
+Set CDB64_BENCH_RECORDS and CDB64_BENCH_ROUNDS to change the workload size.
+The Node and Python bindings must already be built (`pnpm build`,
+`maturin develop --release`).
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+HARNESSES = {
+    "rust": (".", ["cargo", "run", "--release", "-q", "-p", "cdb64", "--example", "bindings_workload"]),
+    "c": ("c", ["make", "-s", "bench"]),
+    "node": ("node", ["node", "__test__/bench.mjs"]),
+    "python": ("python", [sys.executable, "tests/bench_bindings.py"]),
+}
+OPS = ["build", "get_hit", "get_miss", "scan"]
+
+
+def parse(lines):
+    results = []
+    for line in lines:
+        line = line.strip()
+        if line.startswith("{"):
+            results.append(json.loads(line))
+    return results
+
+
+def run(lang):
+    cwd, command = HARNESSES[lang]
+    print("running %s: %s" % (lang, " ".join(command)), file=sys.stderr)
+    proc = subprocess.run(command, cwd=os.path.join(ROOT, cwd), stdout=subprocess.PIPE, text=True)
+    if proc.returncode != 0:
+        print("  %s harness failed with exit code %d, skipping" % (lang, proc.returncode), file=sys.stderr)
+        return []
+    return parse(proc.stdout.splitlines())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="*", help="saved JSON-lines output to compare instead of running")
+    parser.add_argument("--only", help="comma-separated harnesses to run (%s)" % ",".join(HARNESSES))
+    args = parser.parse_args()
+
+    results = []
+    if args.files:
+        for name in args.files:
+            with open(name) as f:
+                results.extend(parse(f))
+    else:
+        langs = args.only.split(",") if args.only else list(HARNESSES)
+        for lang in langs:
+            if lang not in HARNESSES:
+                parser.error("unknown harness %r" % lang)
+            results.extend(run(lang))
+
+    table = {(r["lang"], r["op"]): r["ns_per_op"] for r in results}
+    langs = [lang for lang in HARNESSES if any(key[0] == lang for key in table)]
+    if not langs:
+        sys.exit("no results")
+    records = {r["records"] for r in results}
+    if len(records) > 1:
+        print("warning: harnesses ran with different record counts: %s" % sorted(records), file=sys.stderr)
+
+    print("ns per record or lookup; ratio to native Rust in parentheses (%s records)" % ", ".join(map(str, sorted(records))))
+    print("%-10s" % "op" + "".join("%20s" % lang for lang in langs))
+    for op in OPS:
+        base = table.get(("rust", op))
+        cells = []
+        for lang in langs:
+            ns = table.get((lang, op))
+            if ns is None:
+                cells.append("%20s" % "-")
+            elif base and lang != "rust":
+                cells.append("%20s" % ("%.1f (%.2fx)" % (ns, ns / base)))
+            else:
+                cells.append("%20s" % ("%.1f" % ns))
+        print("%-10s" % op + "".join(cells))
+
+
+if __name__ == "__main__":
+    main()
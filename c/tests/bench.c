@@ -0,0 +1,156 @@
+// C API harness for the cross-language binding benchmarks.
+//
+// Runs the workload described in cdb64/examples/bindings_workload.rs through the
+// C API and prints one JSON line per operation. Build and run with `make bench`.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/cdb64.h"
+
+#ifndef CDB_SUCCESS
+#define CDB_SUCCESS 0
+#endif
+
+#define HIT_STRIDE 1000003ULL
+
+typedef struct {
+    unsigned char *ptr;
+    size_t len;
+} buf_t;
+
+static uint64_t env_or(const char *name, uint64_t fallback) {
+    const char *value = getenv(name);
+    if (value == NULL || *value == '\0') {
+        return fallback;
+    }
+    return strtoull(value, NULL, 10);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static buf_t format_key(const char *prefix, uint64_t i) {
+    char tmp[32];
+    int len = snprintf(tmp, sizeof(tmp), "%s%llu", prefix, (unsigned long long)i);
+    buf_t key = {malloc((size_t)len), (size_t)len};
+    memcpy(key.ptr, tmp, (size_t)len);
+    return key;
+}
+
+static void fail(const char *what) {
+    fprintf(stderr, "bench: %s failed\n", what);
+    exit(EXIT_FAILURE);
+}
+
+static void report(const char *op, uint64_t records, double ns_per_op) {
+    printf("{\"lang\": \"c\", \"op\": \"%s\", \"records\": %llu, \"ns_per_op\": %.1f}\n",
+           op, (unsigned long long)records, ns_per_op);
+}
+
+static void build(const char *path, buf_t *keys, buf_t *values, uint64_t n) {
+    cdb_CdbWriterFile *writer = cdb_writer_create(path);
+    if (!writer) fail("cdb_writer_create");
+    for (uint64_t i = 0; i < n; ++i) {
+        if (cdb_writer_put(writer, keys[i].ptr, keys[i].len, values[i].ptr, values[i].len) != CDB_SUCCESS)
+            fail("cdb_writer_put");
+    }
+    if (cdb_writer_finalize(writer) != CDB_SUCCESS) fail("cdb_writer_finalize");
+    cdb_writer_free(writer);
+}
+
+static void lookup_all(cdb_CdbFile *reader, buf_t *keys, uint64_t n, int expect_hit) {
+    for (uint64_t i = 0; i < n; ++i) {
+        cdb_CdbData value;
+        if (cdb_get(reader, keys[i].ptr, keys[i].len, &value) != CDB_SUCCESS) fail("cdb_get");
+        if ((value.ptr != NULL) != expect_hit) fail("cdb_get result");
+        cdb_free_data(value);
+    }
+}
+
+static void scan_all(const char *path, uint64_t n) {
+    // The iterator takes ownership of the reader, so each scan opens its own.
+    cdb_CdbFile *reader = cdb_open(path);
+    if (!reader) fail("cdb_open");
+    cdb_OwnedCdbIterator *iterator = cdb_iterator_new(reader);
+    if (!iterator) fail("cdb_iterator_new");
+    cdb_CdbKeyValue kv;
+    uint64_t count = 0;
+    while (cdb_iterator_next(iterator, &kv) == cdb_CDB_ITERATOR_HAS_NEXT) {
+        cdb_free_data(kv.key);
+        cdb_free_data(kv.value);
+        ++count;
+    }
+    cdb_iterator_free(iterator);
+    if (count != n) fail("scan count");
+}
+
+int main(void) {
+    uint64_t n = env_or("CDB64_BENCH_RECORDS", 100000);
+    uint64_t rounds = env_or("CDB64_BENCH_ROUNDS", 3);
+    if (n == 0) n = 1;
+    if (rounds == 0) rounds = 1;
+
+    char path[256];
+    const char *tmp = getenv("TMPDIR");
+    snprintf(path, sizeof(path), "%s/cdb64-bench-c-%ld.cdb", tmp ? tmp : "/tmp", (long)getpid());
+
+    buf_t *keys = malloc(n * sizeof(buf_t));
+    buf_t *values = malloc(n * sizeof(buf_t));
+    buf_t *hits = malloc(n * sizeof(buf_t));
+    buf_t *misses = malloc(n * sizeof(buf_t));
+    if (!keys || !values || !hits || !misses) fail("malloc");
+    for (uint64_t i = 0; i < n; ++i) {
+        keys[i] = format_key("key", i);
+        values[i].len = 10 + (i * 7919) % 191;
+        values[i].ptr = malloc(values[i].len);
+        memset(values[i].ptr, (int)(i % 256), values[i].len);
+        hits[i] = format_key("key", (i * HIT_STRIDE) % n);
+        misses[i] = format_key("miss", i);
+    }
+
+    const char *ops[] = {"build", "get_hit", "get_miss", "scan"};
+    double best[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+    cdb_CdbFile *reader = NULL;
+    for (int op = 0; op < 4; ++op) {
+        for (uint64_t round = 0; round < rounds; ++round) {
+            double start = now_ns();
+            switch (op) {
+            case 0: build(path, keys, values, n); break;
+            case 1: lookup_all(reader, hits, n, 1); break;
+            case 2: lookup_all(reader, misses, n, 0); break;
+            case 3: scan_all(path, n); break;
+            }
+            double elapsed = (now_ns() - start) / (double)n;
+            if (elapsed < best[op]) best[op] = elapsed;
+        }
+        if (op == 0) {
+            reader = cdb_open(path);
+            if (!reader) fail("cdb_open");
+        }
+        report(ops[op], n, best[op]);
+    }
+
+    cdb_close(reader);
+    for (uint64_t i = 0; i < n; ++i) {
+        free(keys[i].ptr);
+        free(values[i].ptr);
+        free(hits[i].ptr);
+        free(misses[i].ptr);
+    }
+    free(keys);
+    free(values);
+    free(hits);
+    free(misses);
+    remove(path);
+    return EXIT_SUCCESS;
+}
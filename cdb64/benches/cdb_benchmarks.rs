@@ -50,6 +50,23 @@ fn cdb_write_benchmark(c: &mut Criterion) {
             writer.finalize().unwrap();
         })
     });
+
+    group.bench_function("build_to_vec", |b| {
+        b.iter(|| CdbWriter::<_, CdbHash>::build_to_vec(std::hint::black_box(&data)).unwrap())
+    });
+
+    #[cfg(feature = "mmap")]
+    group.bench_function("build_mmap_temp_file", |b| {
+        b.iter(|| {
+            let temp_file = NamedTempFile::new().unwrap();
+            CdbWriter::<File, CdbHash>::build_mmap(
+                temp_file.path(),
+                std::hint::black_box(&data),
+                cdb64::FlushPolicy::Lazy,
+            )
+            .unwrap();
+        })
+    });
     group.finish();
 }
 
@@ -161,5 +178,55 @@ fn cdb_read_benchmark(c: &mut Criterion) {
     group.finish();
 }
 
-criterion_group!(benches, cdb_write_benchmark, cdb_read_benchmark);
+/// Cached `locate` (the probe without the value copy), before and after `validated()`.
+fn cdb_probe_benchmark(c: &mut Criterion) {
+    let mut group = c.benchmark_group("CdbProbe");
+    let data = generate_kv_pairs(NUM_ENTRIES_FOR_BENCH, 42);
+    let keys_to_lookup: Vec<Vec<u8>> = data.iter().map(|(k, _)| k.clone()).collect();
+    let bytes = CdbWriter::<_, CdbHash>::build_to_vec(&data).unwrap();
+
+    let mut bench_locate = |name: &str, cdb: &dyn Fn(&[u8]) -> bool| {
+        group.bench_function(name, |b| {
+            b.iter(|| {
+                for key in keys_to_lookup.iter() {
+                    std::hint::black_box(cdb(std::hint::black_box(key)));
+                }
+            })
+        });
+    };
+
+    let plain = Cdb::<_, CdbHash>::new(bytes.as_slice()).unwrap();
+    let validated = Cdb::<_, CdbHash>::new(bytes.as_slice())
+        .unwrap()
+        .validated()
+        .unwrap();
+    bench_locate("locate_memory", &|key| plain.locate(key).unwrap().is_some());
+    bench_locate("locate_memory_validated", &|key| {
+        validated.locate(key).unwrap().is_some()
+    });
+
+    #[cfg(feature = "mmap")]
+    {
+        let temp_file = NamedTempFile::new().unwrap();
+        std::fs::write(temp_file.path(), &bytes).unwrap();
+        let plain = Cdb::<File, CdbHash>::open_mmap(temp_file.path()).unwrap();
+        let validated = Cdb::<File, CdbHash>::open_mmap(temp_file.path())
+            .unwrap()
+            .validated()
+            .unwrap();
+        bench_locate("locate_mmap", &|key| plain.locate(key).unwrap().is_some());
+        bench_locate("locate_mmap_validated", &|key| {
+            validated.locate(key).unwrap().is_some()
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    cdb_write_benchmark,
+    cdb_read_benchmark,
+    cdb_probe_benchmark
+);
 criterion_main!(benches);
@@ -0,0 +1,320 @@
+//! Cold-cache lookup benchmark.
+//!
+//! The Criterion `get_from_file_uncached` case reopens the file, but its pages stay
+//! in the OS page cache. This benchmark evicts the file with
+//! `posix_fadvise(POSIX_FADV_DONTNEED)` before every sample instead. It then reports,
+//! for both `pread` and `open_mmap` readers:
+//!
+//! * open and first-lookup latency on a cold cache;
+//! * pages brought into the page cache by the open and by the first lookup, counted
+//!   with `mincore`, so readahead is included;
+//! * time-to-warm: how long a lookup stream takes, after eviction, before its batch
+//!   latency comes within `CDB64_CC_WARM_FACTOR` of the fully cached latency.
+//!
+//! | Variable | Default | Meaning |
+//! |---|---|---|
+//! | `CDB64_CC_RECORDS` | `1M` | Records in the database |
+//! | `CDB64_CC_KEYS` | `lognormal:24:0.4:128` | Key length distribution |
+//! | `CDB64_CC_VALUES` | `lognormal:100:1.0:65536` | Value length distribution |
+//! | `CDB64_CC_ACCESS` | `zipf:0.99` | `uniform` or `zipf:EXPONENT` |
+//! | `CDB64_CC_SAMPLES` | `100` | Cold open/first-lookup samples per reader |
+//! | `CDB64_CC_WARM_BATCH` | `1000` | Lookups per time-to-warm batch |
+//! | `CDB64_CC_WARM_MAX` | `2M` | Give up on warming after this many lookups |
+//! | `CDB64_CC_WARM_FACTOR` | `1.2` | "Warm" once batch latency is within this factor |
+//! | `CDB64_CC_DIR` | `target/tmp` | Where the database is written |
+//!
+//! Eviction has no effect on tmpfs, which is why the file does not go to the temp
+//! directory by default. The benchmark warns when pages survive eviction.
+//!
+//! ```sh
+//! cargo bench -p cdb64 --features mmap --bench cold_cache
+//! ```
+
+mod workload;
+
+#[cfg(target_os = "linux")]
+fn main() -> std::io::Result<()> {
+    linux::run()
+}
+
+#[cfg(not(target_os = "linux"))]
+fn main() {
+    eprintln!("cold_cache needs posix_fadvise and mincore; skipping on this platform");
+}
+
+#[cfg(target_os = "linux")]
+mod linux {
+    use crate::workload::{Access, Dataset, Latencies, SizeDist, SplitMix64, env_or, parse_count};
+    use cdb64::{Cdb, CdbHash, CdbWriter};
+    use std::{
+        fs::File,
+        hint::black_box,
+        io,
+        os::fd::AsRawFd,
+        path::{Path, PathBuf},
+        ptr,
+        time::{Duration, Instant},
+    };
+
+    #[derive(Clone, Copy)]
+    enum Reader {
+        Pread,
+        #[cfg(feature = "mmap")]
+        Mmap,
+    }
+
+    impl Reader {
+        const ALL: &[Reader] = &[
+            Reader::Pread,
+            #[cfg(feature = "mmap")]
+            Reader::Mmap,
+        ];
+
+        fn name(self) -> &'static str {
+            match self {
+                Reader::Pread => "pread",
+                #[cfg(feature = "mmap")]
+                Reader::Mmap => "mmap",
+            }
+        }
+
+        fn open(self, path: &Path) -> io::Result<Cdb<File, CdbHash>> {
+            match self {
+                Reader::Pread => Cdb::open(path),
+                #[cfg(feature = "mmap")]
+                Reader::Mmap => Cdb::open_mmap(path),
+            }
+        }
+    }
+
+    /// Drops the file's clean pages from the page cache.
+    fn evict(path: &Path) -> io::Result<()> {
+        let file = File::open(path)?;
+        let ret = unsafe { libc::posix_fadvise(file.as_raw_fd(), 0, 0, libc::POSIX_FADV_DONTNEED) };
+        if ret != 0 {
+            return Err(io::Error::from_raw_os_error(ret));
+        }
+        Ok(())
+    }
+
+    /// Evicts the file, retrying briefly while readahead from the previous sample is
+    /// still in flight. Returns the pages that remain resident.
+    fn evict_until_cold(path: &Path) -> io::Result<usize> {
+        let mut resident = 0;
+        for _ in 0..5 {
+            evict(path)?;
+            resident = resident_pages(path)?.0;
+            if resident == 0 {
+                break;
+            }
+            std::thread::sleep(Duration::from_millis(2));
+        }
+        Ok(resident)
+    }
+
+    /// Returns `(resident, total)` pages of the file, using `mincore` on a fresh mapping.
+    fn resident_pages(path: &Path) -> io::Result<(usize, usize)> {
+        let file = File::open(path)?;
+        let len = file.metadata()?.len() as usize;
+        if len == 0 {
+            return Ok((0, 0));
+        }
+        let page = unsafe { libc::sysconf(libc::_SC_PAGESIZE) } as usize;
+        let mut vec = vec![0u8; len.div_ceil(page)];
+        unsafe {
+            let addr = libc::mmap(
+                ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_SHARED,
+                file.as_raw_fd(),
+                0,
+            );
+            if addr == libc::MAP_FAILED {
+                return Err(io::Error::last_os_error());
+            }
+            let ret = libc::mincore(addr, len, vec.as_mut_ptr());
+            let err = io::Error::last_os_error();
+            libc::munmap(addr, len);
+            if ret != 0 {
+                return Err(err);
+            }
+        }
+        Ok((vec.iter().filter(|&&b| b & 1 != 0).count(), vec.len()))
+    }
+
+    fn build(dataset: &Dataset, path: &Path) -> io::Result<()> {
+        let mut writer =
+            CdbWriter::<_, CdbHash>::new(File::create(path)?).map_err(io::Error::other)?;
+        let (mut key, mut value) = (Vec::new(), Vec::new());
+        for i in 0..dataset.records {
+            dataset.key(i, &mut key);
+            dataset.value(i, &mut value);
+            writer.put(&key, &value).map_err(io::Error::other)?;
+        }
+        writer.finalize().map_err(io::Error::other)?;
+        // Dirty pages cannot be evicted, so make sure everything is on disk first.
+        File::open(path)?.sync_all()
+    }
+
+    fn mean(values: &[usize]) -> f64 {
+        values.iter().sum::<usize>() as f64 / values.len().max(1) as f64
+    }
+
+    fn cold_samples(
+        reader: Reader,
+        path: &Path,
+        keys: &[Vec<u8>],
+        samples: usize,
+    ) -> io::Result<()> {
+        let mut open_latency = Latencies::with_capacity(samples);
+        let mut lookup_latency = Latencies::with_capacity(samples);
+        let (mut open_pages, mut lookup_pages, mut leftover) = (vec![], vec![], 0);
+        for key in keys.iter().cycle().take(samples) {
+            let before = evict_until_cold(path)?;
+            leftover += before;
+
+            let started = Instant::now();
+            let cdb = reader.open(path)?;
+            open_latency.record(started.elapsed().as_nanos() as u64);
+            let (after_open, _) = resident_pages(path)?;
+
+            let started = Instant::now();
+            black_box(cdb.get(key)?.expect("key must exist"));
+            lookup_latency.record(started.elapsed().as_nanos() as u64);
+            let (after_lookup, _) = resident_pages(path)?;
+
+            open_pages.push(after_open.saturating_sub(before));
+            lookup_pages.push(after_lookup.saturating_sub(after_open));
+        }
+
+        let name = reader.name();
+        println!("  {name} cold open ns: {}", open_latency.summary());
+        println!(
+            "  {name} cold first lookup ns: {}",
+            lookup_latency.summary()
+        );
+        println!(
+            "  {name} pages read: open {:.1}, first lookup {:.1} (mean, including readahead)",
+            mean(&open_pages),
+            mean(&lookup_pages),
+        );
+        if leftover > samples {
+            println!(
+                "  warning: {:.1} pages per sample survived eviction; is {} on tmpfs?",
+                leftover as f64 / samples as f64,
+                path.display()
+            );
+        }
+        Ok(())
+    }
+
+    fn batch_latency(cdb: &Cdb<File, CdbHash>, keys: &[Vec<u8>]) -> io::Result<Duration> {
+        let started = Instant::now();
+        for key in keys {
+            black_box(cdb.get(key)?);
+        }
+        Ok(started.elapsed() / keys.len() as u32)
+    }
+
+    fn time_to_warm(
+        reader: Reader,
+        path: &Path,
+        keys: &[Vec<u8>],
+        batch: usize,
+        factor: f64,
+    ) -> io::Result<()> {
+        // Baseline: the same stream with the whole file cached.
+        io::copy(&mut File::open(path)?, &mut io::sink())?;
+        let cdb = reader.open(path)?;
+        let warm = keys
+            .chunks(batch)
+            .take(4)
+            .map(|chunk| batch_latency(&cdb, chunk))
+            .collect::<io::Result<Vec<_>>>()?
+            .into_iter()
+            .min()
+            .unwrap_or_default();
+        drop(cdb);
+
+        evict_until_cold(path)?;
+        let started = Instant::now();
+        let cdb = reader.open(path)?;
+        let mut done = 0;
+        for chunk in keys.chunks(batch) {
+            let latency = batch_latency(&cdb, chunk)?;
+            done += chunk.len();
+            if latency.as_secs_f64() <= warm.as_secs_f64() * factor {
+                let (resident, total) = resident_pages(path)?;
+                println!(
+                    "  {} time-to-warm: {:.3} s, {done} lookups, {:.1}% of pages resident (warm batch mean {} ns)",
+                    reader.name(),
+                    started.elapsed().as_secs_f64(),
+                    resident as f64 * 100.0 / total as f64,
+                    warm.as_nanos()
+                );
+                return Ok(());
+            }
+        }
+        println!(
+            "  {} time-to-warm: not within {factor}x of {} ns after {done} lookups ({:.3} s)",
+            reader.name(),
+            warm.as_nanos(),
+            started.elapsed().as_secs_f64()
+        );
+        Ok(())
+    }
+
+    pub fn run() -> io::Result<()> {
+        let count = |name: &str, default: &str| {
+            parse_count(&env_or(name, default.to_string()))
+                .unwrap_or_else(|e| panic!("{name}: {e}"))
+        };
+        let records = count("CDB64_CC_RECORDS", "1M").max(1);
+        let samples = count("CDB64_CC_SAMPLES", "100").max(1) as usize;
+        let batch = count("CDB64_CC_WARM_BATCH", "1000").max(1) as usize;
+        let warm_max = count("CDB64_CC_WARM_MAX", "2M").max(1) as usize;
+        let factor: f64 = env_or("CDB64_CC_WARM_FACTOR", 1.2);
+        let access_spec = env_or("CDB64_CC_ACCESS", "zipf:0.99".to_string());
+        let dataset = Dataset {
+            seed: 42,
+            records,
+            key_len: env_or::<SizeDist>("CDB64_CC_KEYS", "lognormal:24:0.4:128".parse().unwrap()),
+            value_len: env_or::<SizeDist>(
+                "CDB64_CC_VALUES",
+                "lognormal:100:1.0:65536".parse().unwrap(),
+            ),
+        };
+        let dir = std::env::var_os("CDB64_CC_DIR")
+            .map(PathBuf::from)
+            .unwrap_or_else(|| PathBuf::from(env!("CARGO_TARGET_TMPDIR")));
+        std::fs::create_dir_all(&dir)?;
+        let path = dir.join(format!("cdb64-cold-cache-{}.cdb", std::process::id()));
+
+        println!(
+            "cold_cache records={records} keys={} values={} access={access_spec} file={}",
+            dataset.key_len,
+            dataset.value_len,
+            path.display()
+        );
+        build(&dataset, &path)?;
+
+        let access =
+            Access::parse(&access_spec, records).unwrap_or_else(|e| panic!("CDB64_CC_ACCESS: {e}"));
+        let mut rng = SplitMix64::new(7);
+        let keys: Vec<Vec<u8>> = (0..warm_max.max(samples))
+            .map(|_| {
+                let mut key = Vec::new();
+                dataset.key(access.sample(&mut rng, records), &mut key);
+                key
+            })
+            .collect();
+
+        let result = Reader::ALL.iter().try_for_each(|&reader| {
+            cold_samples(reader, &path, &keys, samples)?;
+            time_to_warm(reader, &path, &keys[..warm_max], batch, factor)
+        });
+        std::fs::remove_file(&path)?;
+        result
+    }
+}
@@ -0,0 +1,216 @@
+//! Large-scale build and lookup benchmark with configurable data and access patterns.
+//!
+//! Unlike the Criterion suite, this builds files with millions to billions of
+//! records, so the hash tables and data no longer fit in CPU caches. Configuration
+//! comes from the environment:
+//!
+//! | Variable | Default | Meaning |
+//! |---|---|---|
+//! | `CDB64_LS_RECORDS` | `1M` | Comma-separated dataset sizes, e.g. `1M,10M,100M,1B` |
+//! | `CDB64_LS_KEYS` | `lognormal:24:0.4:128` | Key length distribution (at least 8 bytes) |
+//! | `CDB64_LS_VALUES` | `lognormal:100:1.0:65536` | Value length distribution |
+//! | `CDB64_LS_ACCESS` | `zipf:0.99` | `uniform` or `zipf:EXPONENT` |
+//! | `CDB64_LS_HIT_RATIO` | `0.9` | Fraction of lookups for keys that exist |
+//! | `CDB64_LS_LOOKUPS` | `1M` | Timed lookups per dataset |
+//! | `CDB64_LS_READER` | `pread` | `pread`, or `mmap` with the `mmap` feature |
+//! | `CDB64_LS_LAYOUT` | `put` | Record layout: `put` order or table-`clustered` |
+//! | `CDB64_LS_SEED` | `42` | Seed of the deterministic generator |
+//! | `CDB64_LS_DIR` | temp dir | Where database files are written |
+//! | `CDB64_LS_REUSE` | `0` | `1` keeps files and reuses an existing one |
+//!
+//! Size distributions are `fixed:N`, `lognormal:MEDIAN:SIGMA[:MAX]` or
+//! `bimodal:SMALL:LARGE:LARGE_FRACTION`.
+//!
+//! ```sh
+//! CDB64_LS_RECORDS=10M CDB64_LS_VALUES=bimodal:64:8192:0.05 \
+//!     cargo bench -p cdb64 --features mmap --bench large_scale
+//! ```
+//!
+//! Build peak RSS is the process high-water mark right after the build, so run one
+//! size per process when comparing it across sizes. The writer keeps 16 bytes per
+//! record in memory until `finalize`, so a 1B-record build needs about 16 GiB.
+
+mod workload;
+
+use cdb64::{Cdb, CdbHash, CdbWriter, DEFAULT_SPILL_MEMORY, RecordLayout};
+use std::{fs::File, hint::black_box, path::Path, time::Instant};
+use workload::{
+    Access, Dataset, Latencies, SizeDist, SplitMix64, env_or, format_bytes, parse_count,
+    peak_rss_bytes,
+};
+
+struct Config {
+    sizes: Vec<u64>,
+    keys: SizeDist,
+    values: SizeDist,
+    access: String,
+    hit_ratio: f64,
+    lookups: u64,
+    reader: String,
+    layout: String,
+    seed: u64,
+    dir: std::path::PathBuf,
+    reuse: bool,
+}
+
+impl Config {
+    fn from_env() -> Self {
+        let sizes = env_or("CDB64_LS_RECORDS", "1M".to_string())
+            .split(',')
+            .map(|s| parse_count(s).unwrap_or_else(|e| panic!("CDB64_LS_RECORDS: {e}")))
+            .collect();
+        Config {
+            sizes,
+            keys: env_or("CDB64_LS_KEYS", "lognormal:24:0.4:128".parse().unwrap()),
+            values: env_or(
+                "CDB64_LS_VALUES",
+                "lognormal:100:1.0:65536".parse().unwrap(),
+            ),
+            access: env_or("CDB64_LS_ACCESS", "zipf:0.99".to_string()),
+            hit_ratio: env_or("CDB64_LS_HIT_RATIO", 0.9),
+            lookups: parse_count(&env_or("CDB64_LS_LOOKUPS", "1M".to_string()))
+                .unwrap_or_else(|e| panic!("CDB64_LS_LOOKUPS: {e}")),
+            reader: env_or("CDB64_LS_READER", "pread".to_string()),
+            layout: env_or("CDB64_LS_LAYOUT", "put".to_string()),
+            seed: env_or("CDB64_LS_SEED", 42),
+            dir: std::env::var_os("CDB64_LS_DIR")
+                .map(Into::into)
+                .unwrap_or_else(std::env::temp_dir),
+            reuse: env_or("CDB64_LS_REUSE", 0u8) != 0,
+        }
+    }
+}
+
+fn build(config: &Config, dataset: &Dataset, path: &Path) -> std::io::Result<()> {
+    let layout = match config.layout.as_str() {
+        "put" => RecordLayout::PutOrder,
+        "clustered" => RecordLayout::TableClustered {
+            memory_budget: DEFAULT_SPILL_MEMORY,
+        },
+        other => panic!("CDB64_LS_LAYOUT={other:?} is not one of put, clustered"),
+    };
+    let started = Instant::now();
+    let mut writer = CdbWriter::<_, CdbHash>::new(File::create(path)?).map_err(to_io)?;
+    writer.set_layout(layout).map_err(to_io)?;
+    let (mut key, mut value) = (Vec::new(), Vec::new());
+    let mut payload = 0u64;
+    for i in 0..dataset.records {
+        dataset.key(i, &mut key);
+        dataset.value(i, &mut value);
+        payload += (key.len() + value.len()) as u64;
+        writer.put(&key, &value).map_err(to_io)?;
+    }
+    writer.finalize().map_err(to_io)?;
+    let secs = started.elapsed().as_secs_f64();
+
+    let file_size = std::fs::metadata(path)?.len();
+    println!(
+        "  build: {} records in {secs:.2} s ({:.1} K records/s, {}/s of payload), file {}, peak RSS {}",
+        dataset.records,
+        dataset.records as f64 / secs / 1e3,
+        format_bytes((payload as f64 / secs) as u64),
+        format_bytes(file_size),
+        peak_rss_bytes().map_or_else(|| "n/a".to_string(), format_bytes),
+    );
+    Ok(())
+}
+
+fn open(config: &Config, path: &Path) -> std::io::Result<Cdb<File, CdbHash>> {
+    match config.reader.as_str() {
+        "pread" => Cdb::open(path),
+        #[cfg(feature = "mmap")]
+        "mmap" => Cdb::open_mmap(path),
+        other => panic!(
+            "CDB64_LS_READER={other:?} is not available (pread, or mmap with --features mmap)"
+        ),
+    }
+}
+
+fn lookups(config: &Config, dataset: &Dataset, cdb: &Cdb<File, CdbHash>) {
+    let n = dataset.records;
+    let access =
+        Access::parse(&config.access, n).unwrap_or_else(|e| panic!("CDB64_LS_ACCESS: {e}"));
+    let mut rng = SplitMix64::new(config.seed ^ 0x5eed);
+
+    // Generate the whole key sequence first so that only `get` is timed.
+    let mut expected = 0u64;
+    let targets: Vec<(Vec<u8>, Option<usize>)> = (0..config.lookups)
+        .map(|j| {
+            let mut key = Vec::new();
+            if rng.next_f64() < config.hit_ratio {
+                let i = access.sample(&mut rng, n);
+                dataset.key(i, &mut key);
+                expected += 1;
+                (key, Some(dataset.value_len(i)))
+            } else {
+                dataset.key(n + j, &mut key);
+                (key, None)
+            }
+        })
+        .collect();
+
+    let mut latencies = Latencies::with_capacity(targets.len());
+    let mut hits = 0u64;
+    let started = Instant::now();
+    for (key, value_len) in &targets {
+        let t = Instant::now();
+        let value = black_box(cdb.get(key).expect("lookup failed"));
+        latencies.record(t.elapsed().as_nanos() as u64);
+        match (&value, value_len) {
+            (Some(value), Some(len)) if value.len() == *len => hits += 1,
+            (None, None) => {}
+            _ => panic!("lookup result does not match the generated dataset"),
+        }
+    }
+    let secs = started.elapsed().as_secs_f64();
+    assert_eq!(hits, expected);
+
+    println!(
+        "  lookup ({}, hit ratio {:.2}): {} ops in {secs:.2} s ({:.1} K ops/s), {hits} hits",
+        config.access,
+        config.hit_ratio,
+        targets.len(),
+        targets.len() as f64 / secs / 1e3,
+    );
+    println!("  latency ns: {}", latencies.summary());
+}
+
+fn to_io(e: cdb64::Error) -> std::io::Error {
+    std::io::Error::other(e)
+}
+
+fn main() -> std::io::Result<()> {
+    let config = Config::from_env();
+    for &records in &config.sizes {
+        let dataset = Dataset {
+            seed: config.seed,
+            records,
+            key_len: config.keys.clone(),
+            value_len: config.values.clone(),
+        };
+        // Name files after everything that shapes their contents, so reuse is safe.
+        let tag = format!("{}/{}/{}", config.keys, config.values, config.layout)
+            .bytes()
+            .fold(config.seed, |h, b| workload::mix64(h ^ b as u64));
+        let path = config
+            .dir
+            .join(format!("cdb64-large-scale-{records}-{tag:016x}.cdb"));
+        println!(
+            "large_scale records={records} keys={} values={} reader={} layout={}",
+            config.keys, config.values, config.reader, config.layout
+        );
+
+        if config.reuse && path.exists() {
+            println!("  build: reusing {}", path.display());
+        } else {
+            build(&config, &dataset, &path)?;
+        }
+        let cdb = open(&config, &path)?;
+        lookups(&config, &dataset, &cdb);
+
+        if !config.reuse {
+            std::fs::remove_file(&path)?;
+        }
+    }
+    Ok(())
+}
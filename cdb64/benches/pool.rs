@@ -0,0 +1,204 @@
+//! `CdbPool` benchmark: open latency and hit rate over many small shards.
+//!
+//! Writes `CDB64_POOL_SHARDS` shard files, then reports for each reader:
+//!
+//! * open latency of `Cdb::open` against a pool reopen of an evicted shard, which reuses
+//!   the cached header;
+//! * for each handle cap in `CDB64_POOL_CAPS`, the hit rate, evictions and lookup
+//!   throughput of a skewed stream of shard accesses through the pool.
+//!
+//! | Variable | Default | Meaning |
+//! |---|---|---|
+//! | `CDB64_POOL_SHARDS` | `5000` | Shard files |
+//! | `CDB64_POOL_RECORDS` | `100` | Records per shard |
+//! | `CDB64_POOL_CAPS` | `64,256,1024` | Comma-separated open-handle caps |
+//! | `CDB64_POOL_ACCESS` | `zipf:0.99` | Shard choice: `uniform` or `zipf:EXPONENT` |
+//! | `CDB64_POOL_LOOKUPS` | `1M` | Lookups per cap |
+//! | `CDB64_POOL_SAMPLES` | `2000` | Open-latency samples |
+//! | `CDB64_POOL_DIR` | temp dir | Where the shards are written |
+//!
+//! ```sh
+//! CDB64_POOL_SHARDS=50K cargo bench -p cdb64 --features mmap --bench pool
+//! ```
+
+mod workload;
+
+use cdb64::{Cdb, CdbHash, CdbPool, CdbWriter};
+use std::{
+    fs::File,
+    hint::black_box,
+    io,
+    path::{Path, PathBuf},
+    time::Instant,
+};
+use workload::{Access, Dataset, Latencies, SizeDist, SplitMix64, env_or, parse_count};
+
+#[derive(Clone, Copy)]
+enum Reader {
+    Pread,
+    #[cfg(feature = "mmap")]
+    Mmap,
+}
+
+impl Reader {
+    const ALL: &[Reader] = &[
+        Reader::Pread,
+        #[cfg(feature = "mmap")]
+        Reader::Mmap,
+    ];
+
+    fn name(self) -> &'static str {
+        match self {
+            Reader::Pread => "pread",
+            #[cfg(feature = "mmap")]
+            Reader::Mmap => "mmap",
+        }
+    }
+
+    fn open(self, path: &Path) -> io::Result<Cdb<File, CdbHash>> {
+        match self {
+            Reader::Pread => Cdb::open(path),
+            #[cfg(feature = "mmap")]
+            Reader::Mmap => Cdb::open_mmap(path),
+        }
+    }
+
+    fn pool(self, max_open: usize) -> CdbPool<CdbHash> {
+        match self {
+            Reader::Pread => CdbPool::new(max_open),
+            #[cfg(feature = "mmap")]
+            Reader::Mmap => CdbPool::with_mmap(max_open),
+        }
+    }
+}
+
+/// Shard `s` holds records `s * per_shard .. (s + 1) * per_shard` of the dataset.
+fn build(dataset: &Dataset, paths: &[PathBuf], per_shard: u64) -> io::Result<()> {
+    let (mut key, mut value) = (Vec::new(), Vec::new());
+    for (s, path) in paths.iter().enumerate() {
+        let records: Vec<(Vec<u8>, Vec<u8>)> = (0..per_shard)
+            .map(|r| {
+                let i = s as u64 * per_shard + r;
+                dataset.key(i, &mut key);
+                dataset.value(i, &mut value);
+                (key.clone(), value.clone())
+            })
+            .collect();
+        let bytes = CdbWriter::<_, CdbHash>::build_to_vec(&records).map_err(io::Error::other)?;
+        std::fs::write(path, bytes)?;
+    }
+    Ok(())
+}
+
+fn open_latency(reader: Reader, paths: &[PathBuf], samples: usize) -> io::Result<()> {
+    let mut direct = Latencies::with_capacity(samples);
+    for path in paths.iter().cycle().take(samples) {
+        let started = Instant::now();
+        black_box(reader.open(path)?);
+        direct.record(started.elapsed().as_nanos() as u64);
+    }
+
+    // With one slot, every get of an alternating pair evicts and reopens.
+    let pool = reader.pool(1);
+    let pair = &paths[..2.min(paths.len())];
+    for path in pair {
+        pool.get(path)?;
+    }
+    let mut reopen = Latencies::with_capacity(samples);
+    for path in pair.iter().cycle().take(samples) {
+        let started = Instant::now();
+        black_box(pool.get(path)?);
+        reopen.record(started.elapsed().as_nanos() as u64);
+    }
+
+    let name = reader.name();
+    println!("  {name} Cdb::open ns: {}", direct.summary());
+    println!(
+        "  {name} pool reopen ns: {} ({} of {} opens reused the header)",
+        reopen.summary(),
+        pool.stats().header_reuses,
+        pool.stats().opens
+    );
+    Ok(())
+}
+
+fn hit_rate(
+    reader: Reader,
+    dataset: &Dataset,
+    paths: &[PathBuf],
+    per_shard: u64,
+    access: &Access,
+    caps: &[usize],
+    lookups: u64,
+) -> io::Result<()> {
+    let shards = paths.len() as u64;
+    for &cap in caps {
+        let pool = reader.pool(cap);
+        let mut rng = SplitMix64::new(7);
+        let mut key = Vec::new();
+        let started = Instant::now();
+        for _ in 0..lookups {
+            let shard = access.sample(&mut rng, shards);
+            dataset.key(shard * per_shard + rng.below(per_shard), &mut key);
+            let cdb = pool.get(&paths[shard as usize])?;
+            black_box(cdb.get(&key)?.expect("key must exist"));
+        }
+        let elapsed = started.elapsed();
+        let stats = pool.stats();
+        println!(
+            "  {} cap={cap}: hit rate {:.2}%, {} opens ({} header reuses), {} evictions, {:.0} ns/lookup",
+            reader.name(),
+            stats.hit_rate() * 100.0,
+            stats.opens,
+            stats.header_reuses,
+            stats.evictions,
+            elapsed.as_nanos() as f64 / lookups as f64
+        );
+    }
+    Ok(())
+}
+
+fn main() -> io::Result<()> {
+    let count = |name: &str, default: &str| {
+        parse_count(&env_or(name, default.to_string())).unwrap_or_else(|e| panic!("{name}: {e}"))
+    };
+    let shards = count("CDB64_POOL_SHARDS", "5000").max(2);
+    let per_shard = count("CDB64_POOL_RECORDS", "100").max(1);
+    let lookups = count("CDB64_POOL_LOOKUPS", "1M").max(1);
+    let samples = count("CDB64_POOL_SAMPLES", "2000").max(1) as usize;
+    let caps: Vec<usize> = env_or("CDB64_POOL_CAPS", "64,256,1024".to_string())
+        .split(',')
+        .map(|cap| parse_count(cap).unwrap_or_else(|e| panic!("CDB64_POOL_CAPS: {e}")) as usize)
+        .collect();
+    let access_spec = env_or("CDB64_POOL_ACCESS", "zipf:0.99".to_string());
+    let access =
+        Access::parse(&access_spec, shards).unwrap_or_else(|e| panic!("CDB64_POOL_ACCESS: {e}"));
+    let dataset = Dataset {
+        seed: 42,
+        records: shards * per_shard,
+        key_len: SizeDist::Fixed(16),
+        value_len: SizeDist::Fixed(64),
+    };
+
+    let dir = std::env::var_os("CDB64_POOL_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(std::env::temp_dir)
+        .join(format!("cdb64-pool-{}", std::process::id()));
+    std::fs::create_dir_all(&dir)?;
+    let paths: Vec<PathBuf> = (0..shards)
+        .map(|s| dir.join(format!("shard-{s:06}.cdb")))
+        .collect();
+
+    println!(
+        "pool shards={shards} records/shard={per_shard} access={access_spec} lookups={lookups} dir={}",
+        dir.display()
+    );
+    let result = build(&dataset, &paths, per_shard).and_then(|()| {
+        Reader::ALL.iter().try_for_each(|&reader| {
+            open_latency(reader, &paths, samples)?;
+            hit_rate(reader, &dataset, &paths, per_shard, &access, &caps, lookups)
+        })
+    });
+    std::fs::remove_dir_all(&dir)?;
+    result
+}
@@ -0,0 +1,398 @@
+//! Workload generation and measurement helpers shared by the standalone benchmarks.
+//!
+//! Everything here is deterministic: record `i` of a [`Dataset`] is derived from the
+//! seed and `i` alone, so a file can be rebuilt or reused without storing the
+//! records, and runs with the same configuration see exactly the same keys.
+
+#![allow(dead_code)]
+
+use std::{env, str::FromStr};
+
+/// SplitMix64, used both as a seedable generator and as a bijective 64-bit mixer.
+#[derive(Clone)]
+pub struct SplitMix64(u64);
+
+const GOLDEN_GAMMA: u64 = 0x9e37_79b9_7f4a_7c15;
+
+impl SplitMix64 {
+    pub fn new(seed: u64) -> Self {
+        SplitMix64(seed)
+    }
+
+    pub fn next_u64(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(GOLDEN_GAMMA);
+        mix64(self.0)
+    }
+
+    /// A uniform float in `[0, 1)`.
+    pub fn next_f64(&mut self) -> f64 {
+        (self.next_u64() >> 11) as f64 * (1.0 / (1u64 << 53) as f64)
+    }
+
+    /// A uniform integer in `[0, bound)`.
+    pub fn below(&mut self, bound: u64) -> u64 {
+        ((self.next_u64() as u128 * bound as u128) >> 64) as u64
+    }
+
+    /// A standard normal deviate (Box-Muller).
+    pub fn next_normal(&mut self) -> f64 {
+        let u1 = 1.0 - self.next_f64(); // (0, 1], so ln() is finite
+        let u2 = self.next_f64();
+        (-2.0 * u1.ln()).sqrt() * (std::f64::consts::TAU * u2).cos()
+    }
+}
+
+/// The SplitMix64 finalizer. It is a bijection on `u64`.
+pub fn mix64(mut z: u64) -> u64 {
+    z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+    z ^ (z >> 31)
+}
+
+/// A distribution of key or value lengths, in bytes.
+///
+/// Parsed from `fixed:N`, `lognormal:MEDIAN:SIGMA[:MAX]` or
+/// `bimodal:SMALL:LARGE:LARGE_FRACTION`.
+#[derive(Clone, Debug)]
+pub enum SizeDist {
+    Fixed(usize),
+    LogNormal {
+        median: f64,
+        sigma: f64,
+        max: usize,
+    },
+    Bimodal {
+        small: usize,
+        large: usize,
+        large_fraction: f64,
+    },
+}
+
+impl SizeDist {
+    pub fn sample(&self, rng: &mut SplitMix64) -> usize {
+        match *self {
+            SizeDist::Fixed(len) => len,
+            SizeDist::LogNormal { median, sigma, max } => {
+                let len = median * (sigma * rng.next_normal()).exp();
+                (len.round() as usize).min(max)
+            }
+            SizeDist::Bimodal {
+                small,
+                large,
+                large_fraction,
+            } => {
+                if rng.next_f64() < large_fraction {
+                    large
+                } else {
+                    small
+                }
+            }
+        }
+    }
+}
+
+impl std::fmt::Display for SizeDist {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            SizeDist::Fixed(len) => write!(f, "fixed:{len}"),
+            SizeDist::LogNormal { median, sigma, max } if max == usize::MAX => {
+                write!(f, "lognormal:{median}:{sigma}")
+            }
+            SizeDist::LogNormal { median, sigma, max } => {
+                write!(f, "lognormal:{median}:{sigma}:{max}")
+            }
+            SizeDist::Bimodal {
+                small,
+                large,
+                large_fraction,
+            } => write!(f, "bimodal:{small}:{large}:{large_fraction}"),
+        }
+    }
+}
+
+impl FromStr for SizeDist {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let parts: Vec<&str> = s.split(':').collect();
+        let num = |i: usize| -> Result<f64, String> {
+            parts
+                .get(i)
+                .ok_or_else(|| format!("{s}: missing parameter {i}"))?
+                .parse::<f64>()
+                .map_err(|e| format!("{s}: {e}"))
+        };
+        match parts[0] {
+            "fixed" => Ok(SizeDist::Fixed(num(1)? as usize)),
+            "lognormal" => Ok(SizeDist::LogNormal {
+                median: num(1)?,
+                sigma: num(2)?,
+                max: if parts.len() > 3 {
+                    num(3)? as usize
+                } else {
+                    usize::MAX
+                },
+            }),
+            "bimodal" => Ok(SizeDist::Bimodal {
+                small: num(1)? as usize,
+                large: num(2)? as usize,
+                large_fraction: num(3)?,
+            }),
+            other => Err(format!(
+                "unknown size distribution {other:?} (fixed, lognormal, bimodal)"
+            )),
+        }
+    }
+}
+
+/// Keys are at least this long, so the leading index bytes keep them unique.
+pub const MIN_KEY_LEN: usize = 8;
+
+/// A deterministic set of `records` key/value pairs.
+///
+/// The first eight bytes of key `i` are a bijective mix of `i`, so keys are unique
+/// and keys for indices `>= records` are guaranteed misses.
+#[derive(Clone, Debug)]
+pub struct Dataset {
+    pub seed: u64,
+    pub records: u64,
+    pub key_len: SizeDist,
+    pub value_len: SizeDist,
+}
+
+impl Dataset {
+    fn rng(&self, i: u64) -> SplitMix64 {
+        SplitMix64::new(mix64(self.seed ^ i.wrapping_mul(GOLDEN_GAMMA)))
+    }
+
+    /// Writes key `i` into `key`. Indices `>= records` produce absent keys.
+    pub fn key(&self, i: u64, key: &mut Vec<u8>) {
+        let mut rng = self.rng(i);
+        let len = self.key_len.sample(&mut rng).max(MIN_KEY_LEN);
+        key.clear();
+        key.extend_from_slice(&mix64(i.wrapping_add(self.seed)).to_be_bytes());
+        while key.len() < len {
+            key.push(b'a' + (rng.next_u64() % 26) as u8);
+        }
+    }
+
+    /// Length of the value of record `i`.
+    pub fn value_len(&self, i: u64) -> usize {
+        let mut rng = self.rng(i);
+        self.key_len.sample(&mut rng); // keep the stream in step with `key`
+        self.value_len.sample(&mut rng)
+    }
+
+    /// Writes the value of record `i` into `value`.
+    pub fn value(&self, i: u64, value: &mut Vec<u8>) {
+        value.clear();
+        value.resize(self.value_len(i), i as u8);
+    }
+}
+
+/// Which record each lookup targets.
+pub enum Access {
+    Uniform,
+    Zipf(Zipf),
+}
+
+impl Access {
+    /// Parses `uniform` or `zipf:EXPONENT` for a dataset of `n` records.
+    pub fn parse(s: &str, n: u64) -> Result<Self, String> {
+        match s.split_once(':') {
+            None if s == "uniform" => Ok(Access::Uniform),
+            Some(("zipf", exponent)) => {
+                let exponent = exponent.parse().map_err(|e| format!("{s}: {e}"))?;
+                Ok(Access::Zipf(Zipf::new(n, exponent)))
+            }
+            _ => Err(format!("unknown access pattern {s:?} (uniform, zipf:S)")),
+        }
+    }
+
+    /// Returns a record index in `[0, n)`.
+    pub fn sample(&self, rng: &mut SplitMix64, n: u64) -> u64 {
+        match self {
+            Access::Uniform => rng.below(n),
+            Access::Zipf(zipf) => zipf.sample_index(rng),
+        }
+    }
+}
+
+/// Zipf distribution over ranks `1..=n` with exponent `s`, sampled in constant time
+/// by rejection-inversion (Hörmann and Derflinger, 1996).
+///
+/// Ranks are scattered over the file by a fixed permutation, so the hottest records
+/// are not simply the first ones written.
+pub struct Zipf {
+    n: u64,
+    s: f64,
+    h_integral_x1: f64,
+    h_integral_n: f64,
+    threshold: f64,
+    stride: u64,
+}
+
+impl Zipf {
+    pub fn new(n: u64, s: f64) -> Self {
+        assert!(n > 0 && s > 0.0, "zipf needs n > 0 and s > 0");
+        let mut zipf = Zipf {
+            n,
+            s,
+            h_integral_x1: 0.0,
+            h_integral_n: 0.0,
+            threshold: 0.0,
+            stride: scatter_stride(n),
+        };
+        zipf.h_integral_x1 = zipf.h_integral(1.5) - 1.0;
+        zipf.h_integral_n = zipf.h_integral(n as f64 + 0.5);
+        zipf.threshold = 2.0 - zipf.h_integral_inv(zipf.h_integral(2.5) - zipf.h(2.0));
+        zipf
+    }
+
+    /// Returns a rank in `1..=n`; rank 1 is the most frequent.
+    pub fn sample_rank(&self, rng: &mut SplitMix64) -> u64 {
+        loop {
+            let u = self.h_integral_n + rng.next_f64() * (self.h_integral_x1 - self.h_integral_n);
+            let x = self.h_integral_inv(u);
+            let k = ((x + 0.5) as u64).clamp(1, self.n);
+            if k as f64 - x <= self.threshold
+                || u >= self.h_integral(k as f64 + 0.5) - self.h(k as f64)
+            {
+                return k;
+            }
+        }
+    }
+
+    /// Returns the record index for a sampled rank.
+    pub fn sample_index(&self, rng: &mut SplitMix64) -> u64 {
+        ((self.sample_rank(rng) - 1) as u128 * self.stride as u128 % self.n as u128) as u64
+    }
+
+    fn h(&self, x: f64) -> f64 {
+        (-self.s * x.ln()).exp()
+    }
+
+    fn h_integral(&self, x: f64) -> f64 {
+        let log_x = x.ln();
+        helper2((1.0 - self.s) * log_x) * log_x
+    }
+
+    fn h_integral_inv(&self, x: f64) -> f64 {
+        let t = (x * (1.0 - self.s)).max(-1.0);
+        (helper1(t) * x).exp()
+    }
+}
+
+/// `ln(1 + x) / x`, accurate near zero.
+fn helper1(x: f64) -> f64 {
+    if x.abs() > 1e-8 {
+        x.ln_1p() / x
+    } else {
+        1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x))
+    }
+}
+
+/// `(e^x - 1) / x`, accurate near zero.
+fn helper2(x: f64) -> f64 {
+    if x.abs() > 1e-8 {
+        x.exp_m1() / x
+    } else {
+        1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x))
+    }
+}
+
+/// A multiplier coprime with `n`, so `i * stride % n` permutes `0..n`.
+fn scatter_stride(n: u64) -> u64 {
+    let gcd = |mut a: u64, mut b: u64| {
+        while b != 0 {
+            (a, b) = (b, a % b);
+        }
+        a
+    };
+    let mut stride = (GOLDEN_GAMMA % n.max(2)) | 1;
+    while gcd(stride, n) != 1 {
+        stride += 2;
+    }
+    stride
+}
+
+/// Recorded latencies, in nanoseconds.
+#[derive(Default)]
+pub struct Latencies(Vec<u64>);
+
+impl Latencies {
+    pub fn with_capacity(n: usize) -> Self {
+        Latencies(Vec::with_capacity(n))
+    }
+
+    pub fn record(&mut self, nanos: u64) {
+        self.0.push(nanos);
+    }
+
+    /// Formats p50, p90, p99, p99.9 and the maximum. Sorts the samples.
+    pub fn summary(&mut self) -> String {
+        if self.0.is_empty() {
+            return "no samples".to_string();
+        }
+        self.0.sort_unstable();
+        let at = |q: f64| self.0[((self.0.len() - 1) as f64 * q).round() as usize];
+        format!(
+            "p50 {} p90 {} p99 {} p99.9 {} max {}",
+            at(0.50),
+            at(0.90),
+            at(0.99),
+            at(0.999),
+            self.0[self.0.len() - 1]
+        )
+    }
+}
+
+/// Peak resident set size of this process (`VmHWM`), in bytes. Linux only.
+pub fn peak_rss_bytes() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|l| l.starts_with("VmHWM:"))?;
+    let kib: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+    Some(kib * 1024)
+}
+
+/// Reads `name` from the environment, or returns `default` if it is unset.
+///
+/// Panics if the variable is set but does not parse, so typos are not silently ignored.
+pub fn env_or<T: FromStr>(name: &str, default: T) -> T
+where
+    T::Err: std::fmt::Display,
+{
+    match env::var(name) {
+        Ok(v) => v
+            .parse()
+            .unwrap_or_else(|e| panic!("{name}={v:?} is invalid: {e}")),
+        Err(_) => default,
+    }
+}
+
+/// Parses a count such as `1000`, `10K`, `500M` or `1B`.
+pub fn parse_count(s: &str) -> Result<u64, String> {
+    let s = s.trim();
+    let (digits, scale) = match s.chars().last().map(|c| c.to_ascii_uppercase()) {
+        Some('K') => (&s[..s.len() - 1], 1_000),
+        Some('M') => (&s[..s.len() - 1], 1_000_000),
+        Some('B' | 'G') => (&s[..s.len() - 1], 1_000_000_000),
+        _ => (s, 1),
+    };
+    digits
+        .parse::<u64>()
+        .map(|n| n * scale)
+        .map_err(|e| format!("{s}: {e}"))
+}
+
+/// Formats a byte count with a binary unit.
+pub fn format_bytes(bytes: u64) -> String {
+    const UNITS: [&str; 5] = ["B", "KiB", "MiB", "GiB", "TiB"];
+    let mut value = bytes as f64;
+    let mut unit = 0;
+    while value >= 1024.0 && unit < UNITS.len() - 1 {
+        value /= 1024.0;
+        unit += 1;
+    }
+    format!("{value:.1} {}", UNITS[unit])
+}
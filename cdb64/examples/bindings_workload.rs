@@ -0,0 +1,105 @@
+//! Native baseline for the cross-language binding benchmarks.
+//!
+//! Runs the workload shared with `c/tests/bench.c`, `node/__test__/bench.mjs` and
+//! `python/tests/bench_bindings.py` and prints one JSON line per operation.
+//! `bench/compare.py` runs all of them and reports each binding relative to this one.
+//!
+//! ```sh
+//! cargo run --release -p cdb64 --example bindings_workload
+//! ```
+//!
+//! The workload, which every harness must reproduce exactly:
+//!
+//! * `CDB64_BENCH_RECORDS` records (default 100000). Record `i` has key `key{i}` and
+//!   a value of `10 + (i * 7919) % 191` bytes, each equal to `i % 256`.
+//! * `build`: put every record in order and finalize.
+//! * `get_hit`: look up `key{(j * 1000003) % n}` for `j` in `0..n`.
+//! * `get_miss`: look up `miss{j}` for `j` in `0..n`.
+//! * `scan`: iterate over every record.
+//!
+//! Each operation runs `CDB64_BENCH_ROUNDS` times (default 3) and the fastest round
+//! is reported, in nanoseconds per record or lookup.
+
+use cdb64::{Cdb, CdbHash, CdbWriter};
+use std::{env, fs::File, hint::black_box, time::Instant};
+
+const HIT_STRIDE: u64 = 1_000_003;
+
+fn env_or(name: &str, default: u64) -> u64 {
+    env::var(name)
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(default)
+}
+
+fn value_for(i: u64) -> Vec<u8> {
+    vec![(i % 256) as u8; (10 + (i * 7919) % 191) as usize]
+}
+
+/// Runs `op` `rounds` times and returns the fastest round in nanoseconds per item.
+fn best_of(rounds: u64, items: u64, mut op: impl FnMut()) -> f64 {
+    (0..rounds)
+        .map(|_| {
+            let start = Instant::now();
+            op();
+            start.elapsed().as_nanos() as f64 / items as f64
+        })
+        .fold(f64::INFINITY, f64::min)
+}
+
+fn report(op: &str, records: u64, ns_per_op: f64) {
+    println!(
+        "{{\"lang\": \"rust\", \"op\": \"{op}\", \"records\": {records}, \"ns_per_op\": {ns_per_op:.1}}}"
+    );
+}
+
+fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let n = env_or("CDB64_BENCH_RECORDS", 100_000);
+    let rounds = env_or("CDB64_BENCH_ROUNDS", 3).max(1);
+    let path = env::temp_dir().join(format!("cdb64-bench-rust-{}.cdb", std::process::id()));
+
+    let records: Vec<(Vec<u8>, Vec<u8>)> = (0..n)
+        .map(|i| (format!("key{i}").into_bytes(), value_for(i)))
+        .collect();
+    let hits: Vec<Vec<u8>> = (0..n)
+        .map(|j| format!("key{}", (j * HIT_STRIDE) % n).into_bytes())
+        .collect();
+    let misses: Vec<Vec<u8>> = (0..n).map(|j| format!("miss{j}").into_bytes()).collect();
+
+    let build = best_of(rounds, n, || {
+        let mut writer = CdbWriter::<_, CdbHash>::new(File::create(&path).unwrap()).unwrap();
+        for (key, value) in &records {
+            writer.put(key, value).unwrap();
+        }
+        writer.finalize().unwrap();
+    });
+    report("build", n, build);
+
+    let cdb = Cdb::<_, CdbHash>::open(&path)?;
+    let get_hit = best_of(rounds, n, || {
+        for key in &hits {
+            black_box(cdb.get(key).unwrap().expect("key must exist"));
+        }
+    });
+    report("get_hit", n, get_hit);
+
+    let get_miss = best_of(rounds, n, || {
+        for key in &misses {
+            assert!(black_box(cdb.get(key).unwrap()).is_none());
+        }
+    });
+    report("get_miss", n, get_miss);
+
+    let scan = best_of(rounds, n, || {
+        let mut count = 0;
+        for record in cdb.iter() {
+            black_box(record.unwrap());
+            count += 1;
+        }
+        assert_eq!(count, n);
+    });
+    report("scan", n, scan);
+
+    std::fs::remove_file(&path)?;
+    Ok(())
+}
@@ -9,7 +9,13 @@ use std::{
 #[cfg(feature = "mmap")]
 use memmap2::Mmap;
 
-use crate::util::{ReaderAt, read_tuple};
+#[cfg(feature = "metrics")]
+use crate::metrics::{Metrics, MetricsSnapshot};
+use crate::{
+    profile::Profiler,
+    util::{ReaderAt, read_tuple},
+    validate::{Validated, fastmod},
+};
 
 /// The size of the CDB header in bytes.
 ///
@@ -26,6 +32,15 @@ pub(crate) struct TableEntry {
     pub(crate) length: u64,
 }
 
+/// The position of a value inside a CDB file, as returned by [`Cdb::locate`].
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct ValueLocation {
+    /// Absolute file offset of the first value byte.
+    pub offset: u64,
+    /// Length of the value in bytes.
+    pub len: u64,
+}
+
 /// Represents an open CDB database. It can only be used for reads.
 ///
 /// A `Cdb` instance provides read-only access to the database. To create or modify
@@ -65,6 +80,21 @@ pub struct Cdb<R, H> {
     _hasher: PhantomData<H>,
     #[cfg(feature = "mmap")]
     mmap: Option<Mmap>,
+    #[cfg(feature = "metrics")]
+    metrics: Metrics,
+    pub(crate) profiler: Profiler,
+    pub(crate) validated: Option<Box<Validated>>,
+}
+
+/// Runs `$body` against the lookup counters; expands to nothing without the `metrics` feature.
+macro_rules! with_metrics {
+    ($cdb:expr, |$m:ident| $body:expr) => {
+        #[cfg(feature = "metrics")]
+        {
+            let $m = &$cdb.metrics;
+            $body;
+        }
+    };
 }
 
 impl<H: Hasher + Default> Cdb<File, H> {
@@ -112,10 +142,42 @@ impl<H: Hasher + Default> Cdb<File, H> {
             header: [TableEntry::default(); 256],
             _hasher: PhantomData,
             mmap: Some(mmap),
+            #[cfg(feature = "metrics")]
+            metrics: Metrics::new(),
+            profiler: Profiler::new(),
+            validated: None,
         };
         cdb.read_header_from_mmap()?; // Read header using mmap
         Ok(cdb)
     }
+
+    /// Wraps an open file whose header was read earlier, skipping the header read. With
+    /// `mmap` (and the `mmap` feature) the file is mapped as by `open_mmap`.
+    pub(crate) fn from_cached_header(
+        file: File,
+        header: [TableEntry; 256],
+        mmap: bool,
+    ) -> io::Result<Self> {
+        #[cfg(feature = "mmap")]
+        let mmap = if mmap {
+            Some(unsafe { Mmap::map(&file)? })
+        } else {
+            None
+        };
+        #[cfg(not(feature = "mmap"))]
+        let _ = mmap;
+        Ok(Cdb {
+            reader: file,
+            header,
+            _hasher: PhantomData,
+            #[cfg(feature = "mmap")]
+            mmap,
+            #[cfg(feature = "metrics")]
+            metrics: Metrics::new(),
+            profiler: Profiler::new(),
+            validated: None,
+        })
+    }
 }
 
 impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
@@ -129,6 +191,10 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
             _hasher: PhantomData,
             #[cfg(feature = "mmap")]
             mmap: None, // mmap is not applicable for generic ReaderAt
+            #[cfg(feature = "metrics")]
+            metrics: Metrics::new(),
+            profiler: Profiler::new(),
+            validated: None,
         };
         cdb.read_header()?;
         Ok(cdb)
@@ -251,6 +317,54 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
     ///    4. If `entry_hash` does not match, probing continues to the next slot.
     /// 6. If the entire hash table chain is traversed without finding the key, it returns `Ok(None)`.
     pub fn get(&self, key: &[u8]) -> io::Result<Option<Vec<u8>>> {
+        #[cfg(feature = "metrics")]
+        let started = std::time::Instant::now();
+        let value = match self.find(key)? {
+            Some(location) => Some(self.read_value(location)?),
+            None => None,
+        };
+        with_metrics!(self, |m| m.lookup(value.is_some(), started.elapsed()));
+        Ok(value)
+    }
+
+    /// Finds the record for `key` and returns where its value is stored, without reading the value.
+    ///
+    /// The probe is the same as [`get`](Self::get): the hash table slots are read and the stored key
+    /// is compared, but the value bytes are left untouched. This is useful for existence checks and
+    /// for serving values straight from the file (see [`read_value`](Self::read_value)).
+    ///
+    /// # Returns
+    ///
+    /// * `Ok(Some(ValueLocation))` with the file offset and length of the value if the key is found.
+    /// * `Ok(None)` if the key is not found in the database.
+    /// * `Err(io::Error)` if an I/O error occurs during the lookup process.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::Cursor;
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer.put(b"key", b"value").unwrap();
+    /// writer.finalize().unwrap();
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    ///
+    /// let location = cdb.locate(b"key").unwrap().unwrap();
+    /// assert_eq!(location.len, 5);
+    /// assert_eq!(cdb.read_value(location).unwrap(), b"value");
+    /// assert!(cdb.locate(b"missing").unwrap().is_none());
+    /// ```
+    pub fn locate(&self, key: &[u8]) -> io::Result<Option<ValueLocation>> {
+        #[cfg(feature = "metrics")]
+        let started = std::time::Instant::now();
+        let location = self.find(key)?;
+        with_metrics!(self, |m| m.lookup(location.is_some(), started.elapsed()));
+        Ok(location)
+    }
+
+    /// Probes the hash table for `key`; the uninstrumented body of `get` and `locate`.
+    fn find(&self, key: &[u8]) -> io::Result<Option<ValueLocation>> {
         let mut hasher = H::default();
         hasher.write(key);
         let hash_val = hasher.finish();
@@ -261,12 +375,22 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
         if table_entry.length == 0 {
             return Ok(None);
         }
+        if let Some(validated) = self.validated.as_deref() {
+            return self.find_validated(key, hash_val, table_entry, validated);
+        }
 
         let starting_slot = (hash_val >> 8) % table_entry.length;
+        let sampled = self
+            .profiler
+            .sample(table_idx, table_entry.offset + starting_slot * 16);
 
         for i in 0..table_entry.length {
             let slot_to_check = (starting_slot + i) % table_entry.length;
             let slot_offset = table_entry.offset + slot_to_check * 16;
+            with_metrics!(self, |m| {
+                Metrics::add(&m.slots_probed, 1);
+                m.read(16)
+            });
 
             #[cfg(feature = "mmap")]
             let (entry_hash, data_offset) = if let Some(mmap_ref) = self.mmap.as_ref() {
@@ -313,103 +437,191 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
             }
 
             if entry_hash == hash_val {
-                match self.get_value_at(data_offset, key)? {
-                    Some(value) => return Ok(Some(value)),
-                    None => continue,
+                match self.locate_value_at(data_offset, key)? {
+                    Some(location) => {
+                        if sampled {
+                            self.profiler.record(key.len() as u64, location);
+                        }
+                        return Ok(Some(location));
+                    }
+                    None => {
+                        with_metrics!(self, |m| Metrics::add(&m.false_matches, 1));
+                        continue;
+                    }
                 }
             }
         }
         Ok(None)
     }
 
-    /// Reads and verifies a key, then returns its associated value.
-    /// Returns `Ok(None)` if the key at `data_offset` does not match `expected_key`.
-    fn get_value_at(&self, data_offset: u64, expected_key: &[u8]) -> io::Result<Option<Vec<u8>>> {
+    /// The probe loop of `find` for a database that passed [`validated`](Self::validated):
+    /// the start slot comes from the table's fastmod reciprocal, the wraparound is a
+    /// compare instead of a `%`, and slots in a mapping are read without bounds checks.
+    fn find_validated(
+        &self,
+        key: &[u8],
+        hash_val: u64,
+        table_entry: TableEntry,
+        validated: &Validated,
+    ) -> io::Result<Option<ValueLocation>> {
+        let table_idx = (hash_val & 0xff) as usize;
+        let len = table_entry.length;
+        let starting_slot = fastmod(hash_val >> 8, validated.reciprocals[table_idx], len);
+        let sampled = self
+            .profiler
+            .sample(table_idx, table_entry.offset + starting_slot * 16);
+
+        let mut slot = starting_slot;
+        loop {
+            with_metrics!(self, |m| {
+                Metrics::add(&m.slots_probed, 1);
+                m.read(16)
+            });
+            let (entry_hash, data_offset) = self.validated_slot(table_entry.offset + slot * 16)?;
+            if entry_hash == 0 && data_offset == 0 {
+                return Ok(None);
+            }
+            if entry_hash == hash_val {
+                if let Some(location) = self.locate_value_at(data_offset, key)? {
+                    if sampled {
+                        self.profiler.record(key.len() as u64, location);
+                    }
+                    return Ok(Some(location));
+                }
+                with_metrics!(self, |m| Metrics::add(&m.false_matches, 1));
+            }
+            slot += 1;
+            if slot == len {
+                slot = 0;
+            }
+            if slot == starting_slot {
+                return Ok(None);
+            }
+        }
+    }
+
+    /// Reads the slot at `offset`, which `validated` has checked lies inside a table.
+    #[inline]
+    fn validated_slot(&self, offset: u64) -> io::Result<(u64, u64)> {
+        #[cfg(feature = "mmap")]
+        let bytes: [u8; 16] = if let Some(mmap_ref) = self.mmap.as_ref() {
+            debug_assert!(offset + 16 <= mmap_ref.len() as u64);
+            // SAFETY: `validated` checked that every table ends inside the mapping, and the
+            // header and mapping do not change after that.
+            unsafe { std::ptr::read_unaligned(mmap_ref.as_ptr().add(offset as usize).cast()) }
+        } else {
+            let mut bytes = [0u8; 16];
+            self.reader.read_exact_at(&mut bytes, offset)?;
+            bytes
+        };
+        #[cfg(not(feature = "mmap"))]
+        let bytes = {
+            let mut bytes = [0u8; 16];
+            self.reader.read_exact_at(&mut bytes, offset)?;
+            bytes
+        };
+        let (hash, data_offset) = bytes.split_at(8);
+        Ok((
+            u64::from_le_bytes(hash.try_into().unwrap()),
+            u64::from_le_bytes(data_offset.try_into().unwrap()),
+        ))
+    }
+
+    /// Length of the mapping, for handles opened with `open_mmap`.
+    pub(crate) fn mapped_len(&self) -> Option<u64> {
         #[cfg(feature = "mmap")]
         if let Some(mmap_ref) = self.mmap.as_ref() {
-            return self.get_value_at_mmap(mmap_ref, data_offset, expected_key);
+            return Some(mmap_ref.len() as u64);
         }
+        None
+    }
 
-        let (key_len, val_len) = read_tuple(&self.reader, data_offset)?;
+    /// Reads the value at a location previously returned by [`locate`](Self::locate).
+    pub fn read_value(&self, location: ValueLocation) -> io::Result<Vec<u8>> {
+        with_metrics!(self, |m| m.read(location.len));
+        #[cfg(feature = "mmap")]
+        if let Some(mmap_ref) = self.mmap.as_ref() {
+            let start = location.offset as usize;
+            let end = start.saturating_add(location.len as usize);
+            if end > mmap_ref.len() {
+                return Err(io::Error::new(
+                    ErrorKind::InvalidData,
+                    "Mmap bounds exceeded for value",
+                ));
+            }
+            return Ok(mmap_ref[start..end].to_vec());
+        }
 
-        if key_len as usize != expected_key.len() {
-            return Ok(None);
+        let mut value_buf = vec![0u8; location.len as usize];
+        if location.len > 0 {
+            self.reader.read_exact_at(&mut value_buf, location.offset)?;
         }
+        Ok(value_buf)
+    }
 
-        if expected_key.is_empty() {
-            let mut value_buf = vec![0u8; val_len as usize];
-            if val_len > 0 {
-                self.reader
-                    .read_exact_at(&mut value_buf, data_offset + 16)?;
-            }
+    /// Reads up to `buf.len()` bytes at `offset`, from the mapping when there is one.
+    pub(crate) fn read_at(&self, buf: &mut [u8], offset: u64) -> io::Result<usize> {
+        #[cfg(feature = "mmap")]
+        let n = if let Some(mmap_ref) = self.mmap.as_ref() {
+            (&mmap_ref[..]).read_at(buf, offset)?
+        } else {
+            self.reader.read_at(buf, offset)?
+        };
+        #[cfg(not(feature = "mmap"))]
+        let n = self.reader.read_at(buf, offset)?;
+        with_metrics!(self, |m| m.read(n as u64));
+        Ok(n)
+    }
 
-            return Ok(Some(value_buf));
+    /// Reads and verifies a key, then returns the location of its associated value.
+    /// Returns `Ok(None)` if the key at `data_offset` does not match `expected_key`.
+    fn locate_value_at(
+        &self,
+        data_offset: u64,
+        expected_key: &[u8],
+    ) -> io::Result<Option<ValueLocation>> {
+        #[cfg(feature = "mmap")]
+        if let Some(mmap_ref) = self.mmap.as_ref() {
+            return self.locate_value_at_mmap(mmap_ref, data_offset, expected_key);
         }
 
-        let mut key_buf = vec![0u8; key_len as usize];
-        self.reader.read_exact_at(&mut key_buf, data_offset + 16)?;
+        let (key_len, val_len) = read_tuple(&self.reader, data_offset)?;
+        with_metrics!(self, |m| m.read(16));
 
-        if key_buf != expected_key {
+        if key_len as usize != expected_key.len() {
             return Ok(None);
         }
 
-        let mut value_buf = vec![0u8; val_len as usize];
-        if val_len > 0 {
-            self.reader
-                .read_exact_at(&mut value_buf, data_offset + 16 + key_len)?;
+        if !expected_key.is_empty() {
+            with_metrics!(self, |m| m.read(key_len));
+            let mut key_buf = vec![0u8; key_len as usize];
+            self.reader.read_exact_at(&mut key_buf, data_offset + 16)?;
+
+            if key_buf != expected_key {
+                return Ok(None);
+            }
         }
-        Ok(Some(value_buf))
+
+        Ok(Some(ValueLocation {
+            offset: data_offset + 16 + key_len,
+            len: val_len,
+        }))
     }
 
     #[cfg(feature = "mmap")]
-    fn get_value_at_mmap(
+    fn locate_value_at_mmap(
         &self,
         mmap_ref: &Mmap,
         data_offset: u64,
         expected_key: &[u8],
-    ) -> io::Result<Option<Vec<u8>>> {
-        let len_offset_usize = data_offset as usize;
-        if len_offset_usize + 16 > mmap_ref.len() {
-            return Err(io::Error::new(
-                ErrorKind::UnexpectedEof,
-                "Mmap bounds exceeded for key/value lengths",
-            ));
-        }
-
-        let key_len_bytes: [u8; 8] = mmap_ref[len_offset_usize..len_offset_usize + 8]
-            .try_into()
-            .map_err(|_| {
-                io::Error::new(ErrorKind::InvalidData, "Failed to slice key_len from mmap")
-            })?;
-        let val_len_bytes: [u8; 8] = mmap_ref[len_offset_usize + 8..len_offset_usize + 16]
-            .try_into()
-            .map_err(|_| {
-                io::Error::new(ErrorKind::InvalidData, "Failed to slice val_len from mmap")
-            })?;
-
-        let key_len = u64::from_le_bytes(key_len_bytes);
-        let val_len = u64::from_le_bytes(val_len_bytes);
+    ) -> io::Result<Option<ValueLocation>> {
+        let (key_len, val_len) = read_tuple_from_mmap(mmap_ref, data_offset)?;
+        with_metrics!(self, |m| m.read(16));
 
         if key_len as usize != expected_key.len() {
             return Ok(None);
         }
-
-        if expected_key.is_empty() {
-            let value_buf = if val_len > 0 {
-                let start = (data_offset + 16) as usize;
-                let end = start + val_len as usize;
-                if end > mmap_ref.len() {
-                    return Err(io::Error::new(
-                        ErrorKind::InvalidData,
-                        "Mmap bounds exceeded for value",
-                    ));
-                }
-                mmap_ref[start..end].to_vec()
-            } else {
-                Vec::new()
-            };
-            return Ok(Some(value_buf));
-        }
+        with_metrics!(self, |m| m.read(key_len));
 
         let key_start = (data_offset + 16) as usize;
         let key_end = key_start + key_len as usize;
@@ -420,27 +632,69 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
                 "Mmap bounds exceeded for key",
             ));
         }
-        let key_buf_slice = &mmap_ref[key_start..key_end];
 
-        if key_buf_slice != expected_key {
+        if &mmap_ref[key_start..key_end] != expected_key {
             return Ok(None);
         }
 
-        let value_buf = if val_len > 0 {
-            let val_start = key_end;
-            let val_end = val_start + val_len as usize;
-            if val_end > mmap_ref.len() {
-                return Err(io::Error::new(
-                    ErrorKind::InvalidData,
-                    "Mmap bounds exceeded for value",
-                ));
-            }
-            mmap_ref[val_start..val_end].to_vec()
-        } else {
-            Vec::new()
-        };
+        Ok(Some(ValueLocation {
+            offset: key_end as u64,
+            len: val_len,
+        }))
+    }
 
-        Ok(Some(value_buf))
+    /// Returns the number of records in the database.
+    ///
+    /// This is computed from the header alone: `CdbWriter` (like the original cdb and the Go
+    /// cdb64 writers) sizes every hash table to twice the number of records it indexes, so no
+    /// table or record has to be read. Duplicate keys are counted once per record.
+    pub fn len(&self) -> u64 {
+        self.header.iter().map(|table| table.length).sum::<u64>() / 2
+    }
+
+    /// Returns `true` if the database contains no records.
+    pub fn is_empty(&self) -> bool {
+        self.header.iter().all(|table| table.length == 0)
+    }
+
+    /// Returns the underlying reader, for example the `File` a database was opened from,
+    /// so that other views of the file can be built from the same open file.
+    pub fn get_ref(&self) -> &R {
+        &self.reader
+    }
+
+    /// Returns the lookup counters and latency histogram collected since the database was
+    /// opened or [`reset_metrics`](Self::reset_metrics) was last called.
+    ///
+    /// Only available with the `metrics` feature. Lookups through `get` and `locate` are
+    /// counted; iteration is not.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::Cursor;
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer.put(b"key", b"value").unwrap();
+    /// writer.finalize().unwrap();
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    ///
+    /// cdb.get(b"key").unwrap();
+    /// cdb.get(b"missing").unwrap();
+    /// let metrics = cdb.metrics();
+    /// assert_eq!((metrics.hits, metrics.misses), (1, 1));
+    /// println!("p99 <= {:?}", metrics.latency.quantile(0.99));
+    /// ```
+    #[cfg(feature = "metrics")]
+    pub fn metrics(&self) -> MetricsSnapshot {
+        self.metrics.snapshot()
+    }
+
+    /// Sets all counters returned by [`metrics`](Self::metrics) back to zero.
+    #[cfg(feature = "metrics")]
+    pub fn reset_metrics(&self) {
+        self.metrics.reset();
     }
 
     /// Returns an iterator over all key-value pairs in the database.
@@ -449,6 +703,17 @@ impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
     pub fn iter(&self) -> crate::iterator::CdbIterator<'_, R, H> {
         crate::iterator::CdbIterator::new(self)
     }
+
+    /// Returns an iterator that resumes at `offset`, a record boundary previously
+    /// returned by [`CdbIterator::position`](crate::CdbIterator::position).
+    ///
+    /// This lets callers that cannot hold a borrowing iterator (for example language
+    /// bindings) keep only the position between steps.
+    pub fn iter_from(&self, offset: u64) -> crate::iterator::CdbIterator<'_, R, H> {
+        let mut iter = crate::iterator::CdbIterator::new(self);
+        iter.current_pos = offset.max(HEADER_SIZE);
+        iter
+    }
 }
 
 #[cfg(feature = "mmap")]
@@ -545,6 +810,66 @@ mod tests {
         assert!(cdb.get(b"any_key").unwrap().is_none());
     }
 
+    #[test]
+    fn test_cdb_locate_and_read_value() {
+        let records = vec![
+            (b"key1".as_ref(), b"value1".as_ref()),
+            (b"".as_ref(), b"empty_key".as_ref()),
+            (b"key_empty_val".as_ref(), b"".as_ref()),
+        ];
+        let cdb = create_in_memory_cdb(&records);
+
+        let location = cdb.locate(b"key1").unwrap().unwrap();
+        assert_eq!(location.offset, HEADER_SIZE + 16 + 4);
+        assert_eq!(location.len, 6);
+        assert_eq!(cdb.read_value(location).unwrap(), b"value1");
+
+        let location = cdb.locate(b"").unwrap().unwrap();
+        assert_eq!(cdb.read_value(location).unwrap(), b"empty_key");
+
+        let location = cdb.locate(b"key_empty_val").unwrap().unwrap();
+        assert_eq!(location.len, 0);
+        assert_eq!(cdb.read_value(location).unwrap(), b"");
+
+        assert!(cdb.locate(b"missing").unwrap().is_none());
+    }
+
+    #[test]
+    fn test_cdb_len() {
+        assert_eq!(create_in_memory_cdb(&[]).len(), 0);
+        assert!(create_in_memory_cdb(&[]).is_empty());
+
+        let records = vec![
+            (b"key1".as_ref(), b"value1".as_ref()),
+            (b"key2".as_ref(), b"value2".as_ref()),
+            (b"key1".as_ref(), b"duplicate".as_ref()),
+        ];
+        let cdb = create_in_memory_cdb(&records);
+        assert_eq!(cdb.len(), 3);
+        assert!(!cdb.is_empty());
+    }
+
+    #[test]
+    fn test_cdb_iter_from_position() {
+        let records = vec![
+            (b"a".as_ref(), b"1".as_ref()),
+            (b"b".as_ref(), b"2".as_ref()),
+            (b"c".as_ref(), b"3".as_ref()),
+        ];
+        let cdb = create_in_memory_cdb(&records);
+
+        let mut iter = cdb.iter();
+        assert_eq!(iter.position(), HEADER_SIZE);
+        assert_eq!(iter.next().unwrap().unwrap().0, b"a");
+        let position = iter.position();
+
+        let rest: Vec<_> = cdb
+            .iter_from(position)
+            .map(|entry| entry.unwrap().0)
+            .collect();
+        assert_eq!(rest, vec![b"b".to_vec(), b"c".to_vec()]);
+    }
+
     #[test]
     fn test_cdb_open_non_existent_file() {
         let result = Cdb::<File, CdbHash>::open("non_existent_file.cdb");
@@ -620,6 +945,48 @@ mod tests {
         assert!(cdb.get(b"key_D").unwrap().is_none());
     }
 
+    #[cfg(feature = "metrics")]
+    #[derive(Default)]
+    struct ConstantHasher;
+
+    #[cfg(feature = "metrics")]
+    impl StdHasher for ConstantHasher {
+        fn finish(&self) -> u64 {
+            0x0108
+        }
+
+        fn write(&mut self, _bytes: &[u8]) {}
+    }
+
+    #[cfg(feature = "metrics")]
+    #[test]
+    fn test_cdb_metrics() {
+        let records = [
+            (b"key_A".as_ref(), b"value_A".as_ref()),
+            (b"key_C".as_ref(), b"value_C".as_ref()),
+        ];
+        // Every key has the same hash, so key_A occupies slot 1 and key_C slot 2 of a
+        // four-slot table, and each probe past a foreign key is a false match.
+        let cdb = create_in_memory_cdb_with_hasher::<ConstantHasher>(&records);
+
+        assert_eq!(cdb.get(b"key_C").unwrap().unwrap(), b"value_C");
+        assert!(cdb.locate(b"key_D").unwrap().is_none());
+
+        let metrics = cdb.metrics();
+        assert_eq!((metrics.lookups, metrics.hits, metrics.misses), (2, 1, 1));
+        assert_eq!(metrics.slots_probed, 2 + 3);
+        assert_eq!(metrics.false_matches, 1 + 2);
+        // Five slots, four record headers and keys, one value.
+        assert_eq!(metrics.reads, 5 + 4 * 2 + 1);
+        assert_eq!(metrics.bytes_read, 5 * 16 + 4 * (16 + 5) + 7);
+        assert_eq!(metrics.latency.count(), 2);
+        assert_eq!(metrics.mean_probe_length(), 2.5);
+
+        cdb.reset_metrics();
+        assert_eq!(cdb.metrics().lookups, 0);
+        assert_eq!(cdb.metrics().latency.count(), 0);
+    }
+
     #[test]
     fn test_read_header_invalid_data_short() {
         let data = vec![0u8; HEADER_SIZE as usize - 10];
@@ -42,7 +42,7 @@ use crate::{
 /// ```
 pub struct CdbIterator<'cdb, R: ReaderAt, H: std::hash::Hasher + Default = crate::hash::CdbHash> {
     cdb: &'cdb Cdb<R, H>,
-    current_pos: u64,
+    pub(crate) current_pos: u64,
     end_pos: u64,
 }
 
@@ -71,6 +71,13 @@ impl<'cdb, R: ReaderAt, H: std::hash::Hasher + Default> CdbIterator<'cdb, R, H>
             end_pos,
         }
     }
+
+    /// Returns the file offset of the next record this iterator will read.
+    ///
+    /// Pass it to [`Cdb::iter_from`] to resume iteration later.
+    pub fn position(&self) -> u64 {
+        self.current_pos
+    }
 }
 
 impl<'a, R: ReaderAt, H: std::hash::Hasher + Default> Iterator for CdbIterator<'a, R, H> {
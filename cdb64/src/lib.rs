@@ -8,10 +8,15 @@
 //!
 //! ## Features
 //!
-//! - CDB file creation (`CdbWriter`)
-//! - CDB file reading and key lookups (`Cdb`)
+//! - CDB file creation (`CdbWriter`), also to non-seekable sinks (`CdbStreamWriter`),
+//!   in memory (`CdbWriter::build_to_vec`) or through a writable mapping (`mmap` feature)
+//! - CDB file reading and key lookups (`Cdb`), including streamed values (`Cdb::get_reader`)
 //! - Database iteration (`CdbIterator`)
 //! - Support for custom hash functions (defaults to CDB hash)
+//! - Optional lookup counters and latency histograms (`metrics` feature, see `Cdb::metrics`)
+//! - Page-cache residency reports on Unix (`Cdb::residency`)
+//! - Sampled access profiles and background warm-up (`Cdb::take_profile`, `Cdb::prefetch`)
+//! - A capped pool of lazily opened shards (`CdbPool`)
 //!
 //! ## Usage Examples
 //!
@@ -91,15 +96,36 @@
 mod cdb;
 mod hash;
 mod iterator;
+#[cfg(feature = "metrics")]
+mod metrics;
+#[cfg(feature = "mmap")]
+mod mmap_writer;
+mod pool;
+mod profile;
+mod residency;
+mod spill;
+mod stream;
 mod util;
+mod validate;
+mod value_reader;
 mod writer;
 
 // re-exports
-pub use cdb::Cdb;
+pub use cdb::{Cdb, ValueLocation};
 pub use hash::CdbHash;
 pub use iterator::CdbIterator;
+#[cfg(feature = "metrics")]
+pub use metrics::{LATENCY_BUCKETS, LatencyHistogram, MetricsSnapshot};
+#[cfg(feature = "mmap")]
+pub use mmap_writer::FlushPolicy;
+pub use pool::{CdbPool, PoolStats};
+pub use profile::{AccessProfile, PROFILE_PAGE_SIZE, Prefetch, PrefetchOptions, PrefetchStats};
+pub use residency::{RegionResidency, Residency};
+pub use spill::DEFAULT_SPILL_MEMORY;
+pub use stream::CdbStreamWriter;
 pub use util::ReaderAt;
-pub use writer::CdbWriter;
+pub use value_reader::ValueReader;
+pub use writer::{CdbWriter, RecordLayout};
 
 /// Errors that can occur when working with CDB databases.
 #[derive(Debug, thiserror::Error)]
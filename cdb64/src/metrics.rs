@@ -0,0 +1,190 @@
+//! Lookup instrumentation, compiled in only with the `metrics` feature.
+//!
+//! Every [`Cdb`](crate::Cdb) carries a set of relaxed atomic counters and a log2
+//! latency histogram, updated on each `get`/`locate`. Without the feature neither the
+//! fields nor the updates exist.
+
+use std::{
+    sync::atomic::{AtomicU64, Ordering::Relaxed},
+    time::Duration,
+};
+
+/// Number of latency buckets; bucket `i` holds lookups that took `[2^i, 2^(i+1))` ns.
+pub const LATENCY_BUCKETS: usize = 64;
+
+pub(crate) struct Metrics {
+    pub(crate) lookups: AtomicU64,
+    pub(crate) hits: AtomicU64,
+    pub(crate) slots_probed: AtomicU64,
+    pub(crate) false_matches: AtomicU64,
+    pub(crate) reads: AtomicU64,
+    pub(crate) bytes_read: AtomicU64,
+    latency: [AtomicU64; LATENCY_BUCKETS],
+}
+
+impl Metrics {
+    pub(crate) fn new() -> Self {
+        Metrics {
+            lookups: AtomicU64::new(0),
+            hits: AtomicU64::new(0),
+            slots_probed: AtomicU64::new(0),
+            false_matches: AtomicU64::new(0),
+            reads: AtomicU64::new(0),
+            bytes_read: AtomicU64::new(0),
+            latency: std::array::from_fn(|_| AtomicU64::new(0)),
+        }
+    }
+
+    pub(crate) fn add(counter: &AtomicU64, n: u64) {
+        counter.fetch_add(n, Relaxed);
+    }
+
+    /// Counts one read of `len` bytes from the file or mapping.
+    pub(crate) fn read(&self, len: u64) {
+        Self::add(&self.reads, 1);
+        Self::add(&self.bytes_read, len);
+    }
+
+    /// Counts a finished lookup.
+    pub(crate) fn lookup(&self, hit: bool, elapsed: Duration) {
+        Self::add(&self.lookups, 1);
+        if hit {
+            Self::add(&self.hits, 1);
+        }
+        let nanos = elapsed.as_nanos().min(u64::MAX as u128) as u64;
+        Self::add(&self.latency[bucket(nanos)], 1);
+    }
+
+    pub(crate) fn snapshot(&self) -> MetricsSnapshot {
+        let lookups = self.lookups.load(Relaxed);
+        let hits = self.hits.load(Relaxed);
+        MetricsSnapshot {
+            lookups,
+            hits,
+            misses: lookups.saturating_sub(hits),
+            slots_probed: self.slots_probed.load(Relaxed),
+            false_matches: self.false_matches.load(Relaxed),
+            reads: self.reads.load(Relaxed),
+            bytes_read: self.bytes_read.load(Relaxed),
+            latency: LatencyHistogram {
+                buckets: std::array::from_fn(|i| self.latency[i].load(Relaxed)),
+            },
+        }
+    }
+
+    pub(crate) fn reset(&self) {
+        for counter in [
+            &self.lookups,
+            &self.hits,
+            &self.slots_probed,
+            &self.false_matches,
+            &self.reads,
+            &self.bytes_read,
+        ]
+        .into_iter()
+        .chain(&self.latency)
+        {
+            counter.store(0, Relaxed);
+        }
+    }
+}
+
+fn bucket(nanos: u64) -> usize {
+    (u64::BITS - 1 - (nanos | 1).leading_zeros()) as usize
+}
+
+/// Counters collected by a [`Cdb`](crate::Cdb) since it was opened or last reset,
+/// returned by [`Cdb::metrics`](crate::Cdb::metrics).
+///
+/// Counters are updated independently, so a snapshot taken during concurrent lookups
+/// may be off by the lookups still in flight.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct MetricsSnapshot {
+    /// Calls to `get` or `locate`.
+    pub lookups: u64,
+    /// Lookups that found their key.
+    pub hits: u64,
+    /// Lookups that did not find their key.
+    pub misses: u64,
+    /// Hash table slots examined, including the empty slot that ends a miss.
+    pub slots_probed: u64,
+    /// Slots whose hash matched but whose stored key did not.
+    pub false_matches: u64,
+    /// Reads of slots, record headers, keys and values, from the file or the mapping.
+    pub reads: u64,
+    /// Bytes covered by those reads.
+    pub bytes_read: u64,
+    /// Distribution of lookup latencies.
+    pub latency: LatencyHistogram,
+}
+
+impl MetricsSnapshot {
+    /// Average slots examined per lookup.
+    pub fn mean_probe_length(&self) -> f64 {
+        self.slots_probed as f64 / self.lookups.max(1) as f64
+    }
+}
+
+/// Lookup latencies in power-of-two buckets of nanoseconds.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LatencyHistogram {
+    buckets: [u64; LATENCY_BUCKETS],
+}
+
+impl LatencyHistogram {
+    /// The raw counts; bucket `i` holds lookups that took `[2^i, 2^(i+1))` ns
+    /// (bucket 0 also holds lookups under 1 ns).
+    pub fn buckets(&self) -> &[u64; LATENCY_BUCKETS] {
+        &self.buckets
+    }
+
+    /// Total number of recorded lookups.
+    pub fn count(&self) -> u64 {
+        self.buckets.iter().sum()
+    }
+
+    /// An upper bound for the `q`-quantile (`0.0..=1.0`), accurate to a factor of two.
+    ///
+    /// Returns `None` if nothing has been recorded.
+    pub fn quantile(&self, q: f64) -> Option<Duration> {
+        let count = self.count();
+        if count == 0 {
+            return None;
+        }
+        let rank = ((count as f64 * q.clamp(0.0, 1.0)).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (i, &n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                return Some(Duration::from_nanos(
+                    1u64.checked_shl(i as u32 + 1).unwrap_or(u64::MAX),
+                ));
+            }
+        }
+        None
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_latency_buckets() {
+        assert_eq!(bucket(0), 0);
+        assert_eq!(bucket(1), 0);
+        assert_eq!(bucket(2), 1);
+        assert_eq!(bucket(1023), 9);
+        assert_eq!(bucket(1024), 10);
+        assert_eq!(bucket(u64::MAX), 63);
+
+        let metrics = Metrics::new();
+        for nanos in [100, 200, 300, 5000] {
+            metrics.lookup(true, Duration::from_nanos(nanos));
+        }
+        let latency = metrics.snapshot().latency;
+        assert_eq!(latency.count(), 4);
+        assert_eq!(latency.quantile(0.5), Some(Duration::from_nanos(256)));
+        assert_eq!(latency.quantile(1.0), Some(Duration::from_nanos(8192)));
+    }
+}
@@ -0,0 +1,174 @@
+//! Building a database by encoding it straight into a writable file mapping.
+
+use std::{
+    fs::{File, OpenOptions},
+    hash::Hasher,
+    io,
+    path::Path,
+};
+
+use memmap2::MmapMut;
+
+use crate::{
+    Error,
+    writer::{CdbWriter, Plan},
+};
+
+/// When [`CdbWriter::build_mmap`] writes the mapped pages back to disk.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum FlushPolicy {
+    /// Leave write-back to the kernel. Fastest, but the file is not durable when
+    /// `build_mmap` returns.
+    Lazy,
+    /// `msync` the whole mapping once everything is encoded.
+    #[default]
+    Msync,
+    /// Start write-back of every `chunk_bytes` as soon as it is encoded, so dirty pages
+    /// never pile up, then wait for all of it at the end. Uses `sync_file_range` on
+    /// Linux and an asynchronous `msync` of the chunk elsewhere.
+    Chunked {
+        /// Bytes encoded between write-back requests.
+        chunk_bytes: usize,
+    },
+}
+
+impl<H: Hasher + Default> CdbWriter<File, H> {
+    /// Builds a database at `path` by encoding `records` into a writable mapping of it.
+    ///
+    /// The final size is computed first and the file is preallocated to it
+    /// (`posix_fallocate` on Linux, so a full disk fails here instead of with `SIGBUS`
+    /// while the mapping is written). The header, records and tables are then copied
+    /// straight into the mapping, with no `write` call per record. The bytes are the same
+    /// as `CdbWriter` produces for the same records in the same order.
+    ///
+    /// Only available with the `mmap` feature. Intended for rebuilds where every record is
+    /// already at hand, for example when compacting or converting another database.
+    ///
+    /// # Errors
+    ///
+    /// Returns `Error::Io` if the file cannot be created, sized, mapped or flushed.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash, FlushPolicy};
+    /// use std::fs::File;
+    /// use tempfile::NamedTempFile;
+    ///
+    /// let file = NamedTempFile::new().unwrap();
+    /// let records = [("apple", "red"), ("banana", "yellow")];
+    /// CdbWriter::<File, CdbHash>::build_mmap(file.path(), &records, FlushPolicy::Msync).unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::open_mmap(file.path()).unwrap();
+    /// assert_eq!(cdb.get(b"apple").unwrap().unwrap(), b"red");
+    /// ```
+    pub fn build_mmap<K: AsRef<[u8]>, V: AsRef<[u8]>>(
+        path: impl AsRef<Path>,
+        records: &[(K, V)],
+        flush: FlushPolicy,
+    ) -> Result<(), Error> {
+        let plan = Plan::new::<H, _, _>(records);
+        if usize::try_from(plan.total).is_err() {
+            return Err(Error::Io(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "database does not fit in the address space",
+            )));
+        }
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(true)
+            .open(path)?;
+        preallocate(&file, plan.total)?;
+
+        // SAFETY: the file was just created and truncated by us; nothing else is expected
+        // to resize it while it is mapped.
+        let mut map = unsafe { MmapMut::map_mut(&file)? };
+        let chunk = match flush {
+            FlushPolicy::Chunked { chunk_bytes } => chunk_bytes.max(1),
+            _ => usize::MAX,
+        };
+        let (mut pos, mut flushed) = (0usize, 0usize);
+        plan.emit(records, |bytes| {
+            map[pos..pos + bytes.len()].copy_from_slice(bytes);
+            pos += bytes.len();
+            if pos - flushed >= chunk {
+                start_writeback(&file, &map, flushed, pos - flushed)?;
+                flushed = pos;
+            }
+            Ok(())
+        })?;
+
+        if flush != FlushPolicy::Lazy {
+            map.flush()?;
+        }
+        Ok(())
+    }
+}
+
+fn preallocate(file: &File, len: u64) -> io::Result<()> {
+    #[cfg(target_os = "linux")]
+    {
+        use std::os::fd::AsRawFd;
+
+        match unsafe { libc::posix_fallocate(file.as_raw_fd(), 0, len as libc::off_t) } {
+            0 => return Ok(()),
+            // Not supported by this file system: fall back to a sparse file.
+            libc::EOPNOTSUPP | libc::EINVAL => {}
+            err => return Err(io::Error::from_raw_os_error(err)),
+        }
+    }
+    file.set_len(len)
+}
+
+#[cfg(target_os = "linux")]
+fn start_writeback(file: &File, _map: &MmapMut, offset: usize, len: usize) -> io::Result<()> {
+    use std::os::fd::AsRawFd;
+
+    let ret = unsafe {
+        libc::sync_file_range(
+            file.as_raw_fd(),
+            offset as libc::off64_t,
+            len as libc::off64_t,
+            libc::SYNC_FILE_RANGE_WRITE,
+        )
+    };
+    if ret != 0 {
+        return Err(io::Error::last_os_error());
+    }
+    Ok(())
+}
+
+#[cfg(not(target_os = "linux"))]
+fn start_writeback(_file: &File, map: &MmapMut, offset: usize, len: usize) -> io::Result<()> {
+    map.flush_async_range(offset, len)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{Cdb, CdbHash};
+    use tempfile::NamedTempFile;
+
+    #[test]
+    fn test_build_mmap_matches_build_to_vec() {
+        let records: Vec<(Vec<u8>, Vec<u8>)> = (0..2000)
+            .map(|i| (format!("key{i}").into_bytes(), vec![i as u8; i % 300]))
+            .collect();
+        let expected = CdbWriter::<_, CdbHash>::build_to_vec(&records).unwrap();
+
+        for flush in [
+            FlushPolicy::Lazy,
+            FlushPolicy::Msync,
+            FlushPolicy::Chunked { chunk_bytes: 4096 },
+        ] {
+            let file = NamedTempFile::new().unwrap();
+            CdbWriter::<File, CdbHash>::build_mmap(file.path(), &records, flush).unwrap();
+            assert!(std::fs::read(file.path()).unwrap() == expected, "{flush:?}");
+
+            let cdb = Cdb::<_, CdbHash>::open_mmap(file.path()).unwrap();
+            assert_eq!(cdb.get(b"key1999").unwrap().unwrap(), vec![207u8; 199]);
+        }
+    }
+}
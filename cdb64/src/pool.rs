@@ -0,0 +1,577 @@
+//! A bounded set of open databases, for processes that address more shards than they can
+//! keep open at once.
+
+use std::{
+    collections::{HashMap, VecDeque},
+    fs::{File, Metadata},
+    hash::Hasher,
+    io,
+    path::{Path, PathBuf},
+    sync::{Arc, Mutex, Weak},
+    time::SystemTime,
+};
+
+use crate::{
+    cdb::{Cdb, TableEntry},
+    hash::CdbHash,
+};
+
+/// Headers a [`CdbPool`] caches per database it keeps open.
+const HEADERS_PER_SLOT: usize = 8;
+
+/// Counters of a [`CdbPool`], as returned by [`CdbPool::stats`].
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct PoolStats {
+    /// Calls to `get` answered by a handle that was already open.
+    pub hits: u64,
+    /// Calls to `get` that had to open the file.
+    pub opens: u64,
+    /// Opens that reused the header cached from an earlier open instead of reading it.
+    pub header_reuses: u64,
+    /// Handles closed to make room for another.
+    pub evictions: u64,
+}
+
+impl PoolStats {
+    /// The fraction of `get` calls that found the database open, from `0.0` to `1.0`.
+    pub fn hit_rate(&self) -> f64 {
+        let total = self.hits + self.opens;
+        if total == 0 {
+            0.0
+        } else {
+            self.hits as f64 / total as f64
+        }
+    }
+}
+
+/// Opens databases by path on demand and keeps at most `max_open` of them in its slots.
+///
+/// [`get`](Self::get) returns the database as an `Arc`. While any clone of it is alive
+/// the handle stays valid, even if the pool evicts it meanwhile; the file is closed when
+/// the last clone is dropped. When the pool is full, the least recently useful handle
+/// is evicted with the CLOCK algorithm. Handles that are in use are passed over while
+/// idle ones remain. If every handle is in use, one is evicted anyway, and while callers
+/// still hold it `get` hands out that same handle again instead of opening the file a
+/// second time. At most `max_open` files plus those evicted-but-held handles are open.
+///
+/// The 4 KiB headers of up to eight times `max_open` recently opened databases are kept
+/// after eviction, also chosen by CLOCK. Reopening such a file skips the header read,
+/// unless its length, modification time or (on Unix) inode changed, which means the file
+/// was replaced. [`clear`](Self::clear) drops them all.
+///
+/// Lookups of open databases take one mutex and a hash map probe. Files are opened and
+/// closed outside the lock, so a slow open or unmap does not stall other shards.
+///
+/// # Examples
+///
+/// ```
+/// use cdb64::{CdbHash, CdbPool, CdbWriter};
+/// use std::fs::File;
+///
+/// let dir = tempfile::tempdir().unwrap();
+/// for shard in 0..3 {
+///     let mut writer = CdbWriter::<File, CdbHash>::create(dir.path().join(format!("{shard}.cdb"))).unwrap();
+///     writer.put(b"shard", shard.to_string().as_bytes()).unwrap();
+///     writer.finalize().unwrap();
+/// }
+///
+/// let pool = CdbPool::<CdbHash>::new(2);
+/// for shard in [0, 1, 2, 0] {
+///     let cdb = pool.get(dir.path().join(format!("{shard}.cdb"))).unwrap();
+///     assert_eq!(cdb.get(b"shard").unwrap().unwrap(), shard.to_string().as_bytes());
+/// }
+/// assert_eq!(pool.len(), 2);
+/// assert_eq!(pool.stats().opens, 4);
+/// ```
+pub struct CdbPool<H: Hasher + Default = CdbHash> {
+    max_open: usize,
+    mmap: bool,
+    state: Mutex<PoolState<H>>,
+}
+
+/// A database as the pool hands it out.
+type Handle<H> = Arc<Cdb<File, H>>;
+
+struct PoolState<H> {
+    slots: Vec<Slot<H>>,
+    index: HashMap<PathBuf, usize>,
+    hand: usize,
+    /// Evicted handles that callers still held at the time.
+    detached: HashMap<PathBuf, Weak<Cdb<File, H>>>,
+    /// `detached` is pruned of dropped handles when it grows to this many entries.
+    detached_limit: usize,
+    headers: HashMap<PathBuf, CachedHeader>,
+    /// The cached headers' paths in CLOCK order, oldest first.
+    header_queue: VecDeque<PathBuf>,
+    stats: PoolStats,
+}
+
+struct Slot<H> {
+    path: PathBuf,
+    cdb: Handle<H>,
+    referenced: bool,
+}
+
+#[derive(Clone)]
+struct CachedHeader {
+    identity: FileIdentity,
+    header: Box<[TableEntry; 256]>,
+    /// Set when the header is reused; gives it a second pass in the queue.
+    referenced: bool,
+}
+
+/// What must match for a cached header to still describe the file at a path.
+#[derive(Clone, Copy, PartialEq, Eq)]
+struct FileIdentity {
+    len: u64,
+    modified: Option<SystemTime>,
+    #[cfg(unix)]
+    inode: (u64, u64),
+}
+
+impl FileIdentity {
+    fn of(metadata: &Metadata) -> Self {
+        #[cfg(unix)]
+        use std::os::unix::fs::MetadataExt;
+
+        FileIdentity {
+            len: metadata.len(),
+            modified: metadata.modified().ok(),
+            #[cfg(unix)]
+            inode: (metadata.dev(), metadata.ino()),
+        }
+    }
+}
+
+impl<H: Hasher + Default> CdbPool<H> {
+    /// Creates a pool that keeps up to `max_open` databases open (at least one), read
+    /// with `pread` as by [`Cdb::open`].
+    pub fn new(max_open: usize) -> Self {
+        Self::with_reader(max_open, false)
+    }
+
+    /// Creates a pool whose databases are memory-mapped, as by [`Cdb::open_mmap`].
+    ///
+    /// Only available with the `mmap` feature. Each open handle holds a mapping as well
+    /// as a file descriptor, so `max_open` bounds both.
+    #[cfg(feature = "mmap")]
+    pub fn with_mmap(max_open: usize) -> Self {
+        Self::with_reader(max_open, true)
+    }
+
+    fn with_reader(max_open: usize, mmap: bool) -> Self {
+        CdbPool {
+            max_open: max_open.max(1),
+            mmap,
+            state: Mutex::new(PoolState {
+                slots: Vec::new(),
+                index: HashMap::new(),
+                hand: 0,
+                detached: HashMap::new(),
+                detached_limit: max_open.max(1),
+                headers: HashMap::new(),
+                header_queue: VecDeque::new(),
+                stats: PoolStats::default(),
+            }),
+        }
+    }
+
+    /// Returns the database at `path`, opening it (and evicting another) if it is not
+    /// open yet.
+    ///
+    /// Paths are compared as given, so use one spelling per file.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from opening the file, reading its header or mapping it.
+    pub fn get(&self, path: impl AsRef<Path>) -> io::Result<Arc<Cdb<File, H>>> {
+        let path = path.as_ref();
+        let cached = {
+            let mut state = self.lock();
+            if let Some((cdb, evicted)) = state.find(path, self.max_open) {
+                state.stats.hits += 1;
+                drop(state);
+                drop(evicted);
+                return Ok(cdb);
+            }
+            state.headers.get(path).cloned()
+        };
+
+        let (opened, header, reused) = match self.open(path, cached) {
+            Ok(opened) => opened,
+            Err(e) => {
+                // The file is gone or unreadable, so its cached header is of no more use.
+                self.lock().forget_header(path);
+                return Err(e);
+            }
+        };
+        let mut state = self.lock();
+        state.stats.opens += 1;
+        state.stats.header_reuses += reused as u64;
+        let max_headers = self.max_open.saturating_mul(HEADERS_PER_SLOT);
+        state.cache_header(path, header, max_headers);
+
+        // Another thread may have opened the same file meanwhile; keep its handle. Ours is
+        // dropped after the guard, outside the lock.
+        let (cdb, evicted) = match state.find(path, self.max_open) {
+            Some(found) => found,
+            None => {
+                let cdb = Arc::new(opened);
+                let evicted = state.insert(path, Arc::clone(&cdb), self.max_open);
+                (cdb, evicted)
+            }
+        };
+        drop(state);
+        // Closing and unmapping the evicted file, if this was its last handle, happens
+        // here, outside the lock.
+        drop(evicted);
+        Ok(cdb)
+    }
+
+    fn open(
+        &self,
+        path: &Path,
+        cached: Option<CachedHeader>,
+    ) -> io::Result<(Cdb<File, H>, CachedHeader, bool)> {
+        let file = File::open(path)?;
+        let identity = FileIdentity::of(&file.metadata()?);
+        if let Some(mut cached) = cached.filter(|cached| cached.identity == identity) {
+            let cdb = Cdb::from_cached_header(file, *cached.header, self.mmap)?;
+            cached.referenced = true;
+            return Ok((cdb, cached, true));
+        }
+        let cdb = Cdb::new(file)?;
+        let header = CachedHeader {
+            identity,
+            header: Box::new(cdb.header),
+            referenced: false,
+        };
+        let cdb = if self.mmap {
+            Cdb::from_cached_header(cdb.reader, cdb.header, true)?
+        } else {
+            cdb
+        };
+        Ok((cdb, header, false))
+    }
+
+    /// Counters since the pool was created.
+    pub fn stats(&self) -> PoolStats {
+        self.lock().stats
+    }
+
+    /// Number of databases the pool currently holds open.
+    pub fn len(&self) -> usize {
+        self.lock().slots.len()
+    }
+
+    /// Returns `true` if the pool holds no open databases.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// The most databases the pool keeps open.
+    pub fn max_open(&self) -> usize {
+        self.max_open
+    }
+
+    /// Closes every idle handle and forgets all cached headers. Handles still referenced
+    /// by callers stay open until they are dropped.
+    pub fn clear(&self) {
+        let slots = {
+            let mut state = self.lock();
+            state.index.clear();
+            state.detached.clear();
+            state.headers.clear();
+            state.header_queue.clear();
+            state.hand = 0;
+            std::mem::take(&mut state.slots)
+        };
+        // Close the files outside the lock.
+        drop(slots);
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, PoolState<H>> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+impl<H> PoolState<H> {
+    /// Returns the open handle for `path`: the one in its slot, or an evicted one that
+    /// callers still hold, which then takes a slot again. The slot evicted to make room
+    /// comes back too, so that it is dropped outside the lock.
+    fn find(&mut self, path: &Path, max_open: usize) -> Option<(Handle<H>, Option<Slot<H>>)> {
+        if let Some(&i) = self.index.get(path) {
+            let slot = &mut self.slots[i];
+            slot.referenced = true;
+            return Some((Arc::clone(&slot.cdb), None));
+        }
+        let cdb = self.detached.remove(path)?.upgrade()?;
+        let evicted = self.insert(path, Arc::clone(&cdb), max_open);
+        Some((cdb, evicted))
+    }
+
+    /// Puts `cdb` in a slot, evicting another handle if all `max_open` are taken, and
+    /// returns the evicted slot.
+    fn insert(&mut self, path: &Path, cdb: Arc<Cdb<File, H>>, max_open: usize) -> Option<Slot<H>> {
+        let slot = Slot {
+            path: path.to_path_buf(),
+            cdb,
+            referenced: true,
+        };
+        if self.slots.len() < max_open {
+            self.index.insert(path.to_path_buf(), self.slots.len());
+            self.slots.push(slot);
+            return None;
+        }
+        let i = self.victim();
+        let old = std::mem::replace(&mut self.slots[i], slot);
+        self.index.remove(&old.path);
+        self.index.insert(path.to_path_buf(), i);
+        self.stats.evictions += 1;
+        if Arc::strong_count(&old.cdb) > 1 {
+            if self.detached.len() >= self.detached_limit {
+                self.detached.retain(|_, cdb| cdb.strong_count() > 0);
+                self.detached_limit = (2 * self.detached.len()).max(max_open);
+            }
+            self.detached
+                .insert(old.path.clone(), Arc::downgrade(&old.cdb));
+        }
+        Some(old)
+    }
+
+    /// Picks the slot to evict with CLOCK: the hand skips and clears referenced slots,
+    /// and skips slots in use. After two full turns every bit is clear, so if every
+    /// handle is in use the one under the hand is taken anyway.
+    fn victim(&mut self) -> usize {
+        let n = self.slots.len();
+        for step in 0..3 * n {
+            let i = self.hand;
+            self.hand = (self.hand + 1) % n;
+            let slot = &mut self.slots[i];
+            if slot.referenced {
+                slot.referenced = false;
+                continue;
+            }
+            if Arc::strong_count(&slot.cdb) > 1 && step < 2 * n {
+                continue;
+            }
+            return i;
+        }
+        unreachable!("every reference bit is clear after two turns")
+    }
+
+    /// Caches `header` for `path`. Once `max` headers are cached, the oldest one that was
+    /// not reused since its last pass is dropped first, which is CLOCK over a queue.
+    fn cache_header(&mut self, path: &Path, header: CachedHeader, max: usize) {
+        if let Some(cached) = self.headers.get_mut(path) {
+            // A replaced file's header takes the place of the stale one.
+            *cached = header;
+            return;
+        }
+        while self.headers.len() >= max {
+            let Some(oldest) = self.header_queue.pop_front() else {
+                break;
+            };
+            match self.headers.get_mut(&oldest) {
+                Some(cached) if cached.referenced => {
+                    cached.referenced = false;
+                    self.header_queue.push_back(oldest);
+                }
+                _ => {
+                    self.headers.remove(&oldest);
+                }
+            }
+        }
+        self.headers.insert(path.to_path_buf(), header);
+        self.header_queue.push_back(path.to_path_buf());
+    }
+
+    fn forget_header(&mut self, path: &Path) {
+        if self.headers.remove(path).is_some() {
+            self.header_queue.retain(|queued| queued != path);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::CdbWriter;
+
+    fn write_shard(path: &Path, value: &[u8]) {
+        let mut writer = CdbWriter::<File, CdbHash>::create(path).unwrap();
+        writer.put(b"key", value).unwrap();
+        writer.finalize().unwrap();
+    }
+
+    #[test]
+    fn test_pool_caps_and_reuses_headers() {
+        let dir = tempfile::tempdir().unwrap();
+        let paths: Vec<PathBuf> = (0..5)
+            .map(|i| {
+                let path = dir.path().join(format!("{i}.cdb"));
+                write_shard(&path, format!("shard{i}").as_bytes());
+                path
+            })
+            .collect();
+
+        let pool = CdbPool::<CdbHash>::new(3);
+        for round in 0..3 {
+            for (i, path) in paths.iter().enumerate() {
+                let cdb = pool.get(path).unwrap();
+                assert_eq!(
+                    cdb.get(b"key").unwrap().unwrap(),
+                    format!("shard{i}").as_bytes()
+                );
+                assert!(pool.len() <= 3, "round {round}");
+            }
+        }
+        let stats = pool.stats();
+        assert_eq!(stats.hits + stats.opens, 15);
+        assert_eq!(
+            stats.opens - stats.header_reuses,
+            5,
+            "each header is read once"
+        );
+        assert_eq!(stats.evictions, stats.opens - 3);
+
+        pool.get(&paths[4]).unwrap();
+        let hits = pool.stats().hits;
+        pool.get(&paths[4]).unwrap();
+        assert_eq!(pool.stats().hits, hits + 1);
+        assert!(pool.get(dir.path().join("missing.cdb")).is_err());
+    }
+
+    #[test]
+    fn test_pool_bounds_header_cache() {
+        let dir = tempfile::tempdir().unwrap();
+        let paths: Vec<PathBuf> = (0..30)
+            .map(|i| {
+                let path = dir.path().join(format!("{i}.cdb"));
+                write_shard(&path, &[i as u8]);
+                path
+            })
+            .collect();
+
+        let pool = CdbPool::<CdbHash>::new(2);
+        let max_headers = 2 * HEADERS_PER_SLOT;
+        // Shard 0 is reopened between the others, so CLOCK keeps its header.
+        for path in &paths {
+            pool.get(path).unwrap();
+            pool.get(&paths[0]).unwrap();
+            let state = pool.lock();
+            assert!(state.headers.len() <= max_headers);
+            assert_eq!(state.headers.len(), state.header_queue.len());
+        }
+        assert!(pool.lock().headers.contains_key(&paths[0]));
+        let reuses = pool.stats().header_reuses;
+        pool.get(&paths[1]).unwrap();
+        pool.get(&paths[2]).unwrap();
+        pool.get(&paths[0]).unwrap();
+        assert_eq!(pool.stats().header_reuses, reuses + 1);
+
+        // A file that can no longer be opened loses its cached header.
+        std::fs::remove_file(&paths[0]).unwrap();
+        for path in &paths[3..6] {
+            pool.get(path).unwrap();
+        }
+        assert!(!pool.lock().index.contains_key(&paths[0]));
+        assert!(pool.lock().headers.contains_key(&paths[0]));
+        assert!(pool.get(&paths[0]).is_err());
+        let state = pool.lock();
+        assert!(!state.headers.contains_key(&paths[0]));
+        assert_eq!(state.headers.len(), state.header_queue.len());
+    }
+
+    #[test]
+    fn test_pool_keeps_handles_in_use() {
+        let dir = tempfile::tempdir().unwrap();
+        let paths: Vec<PathBuf> = (0..4)
+            .map(|i| {
+                let path = dir.path().join(format!("{i}.cdb"));
+                write_shard(&path, &[i as u8]);
+                path
+            })
+            .collect();
+
+        let pool = CdbPool::<CdbHash>::new(2);
+        let held = pool.get(&paths[0]).unwrap();
+        for path in &paths[1..] {
+            pool.get(path).unwrap();
+        }
+        // The held handle was never idle, so the other shards took turns in one slot.
+        assert!(Arc::ptr_eq(&held, &pool.get(&paths[0]).unwrap()));
+
+        // With every handle in use, the pool still makes room and the guards stay valid.
+        let guards: Vec<_> = paths.iter().map(|path| pool.get(path).unwrap()).collect();
+        assert_eq!(pool.len(), 2);
+        for (i, cdb) in guards.iter().enumerate() {
+            assert_eq!(cdb.get(b"key").unwrap().unwrap(), [i as u8]);
+        }
+
+        // Evicted handles that are still held are handed out again, not reopened.
+        let opens = pool.stats().opens;
+        for _ in 0..2 {
+            for (path, guard) in paths.iter().zip(&guards) {
+                assert!(Arc::ptr_eq(guard, &pool.get(path).unwrap()));
+            }
+        }
+        assert_eq!(pool.stats().opens, opens);
+        assert_eq!(pool.len(), 2);
+
+        // Once dropped, the two shards outside the slots are opened afresh.
+        drop((guards, held));
+        for (i, path) in paths.iter().enumerate() {
+            assert_eq!(
+                pool.get(path).unwrap().get(b"key").unwrap().unwrap(),
+                [i as u8]
+            );
+        }
+        assert!(pool.stats().opens >= opens + 2);
+    }
+
+    #[test]
+    fn test_pool_detects_replaced_file() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("shard.cdb");
+        let other = dir.path().join("other.cdb");
+        write_shard(&path, b"old");
+        write_shard(&other, b"other");
+
+        let pool = CdbPool::<CdbHash>::new(1);
+        assert_eq!(
+            pool.get(&path).unwrap().get(b"key").unwrap().unwrap(),
+            b"old"
+        );
+        pool.get(&other).unwrap();
+
+        let replacement = dir.path().join("new.cdb");
+        let mut writer = CdbWriter::<File, CdbHash>::create(&replacement).unwrap();
+        for i in 0..100 {
+            writer.put(format!("pad{i}").as_bytes(), b"").unwrap();
+        }
+        writer.put(b"key", b"new").unwrap();
+        writer.finalize().unwrap();
+        std::fs::rename(&replacement, &path).unwrap();
+
+        let reuses = pool.stats().header_reuses;
+        assert_eq!(
+            pool.get(&path).unwrap().get(b"key").unwrap().unwrap(),
+            b"new"
+        );
+        assert_eq!(pool.stats().header_reuses, reuses);
+
+        #[cfg(feature = "mmap")]
+        {
+            let pool = CdbPool::<CdbHash>::with_mmap(1);
+            for _ in 0..2 {
+                assert_eq!(
+                    pool.get(&path).unwrap().get(b"key").unwrap().unwrap(),
+                    b"new"
+                );
+                pool.get(&other).unwrap();
+            }
+            assert_eq!(pool.stats().header_reuses, 2);
+        }
+    }
+}
@@ -0,0 +1,678 @@
+//! Sampled access profiles and background warm-up.
+//!
+//! A running [`Cdb`] can sample its lookups into an [`AccessProfile`]: which of the 256
+//! tables were probed, which slot pages were read and which records were returned. The
+//! profile is saved next to the database and, after a restart or deploy, replayed with
+//! [`Cdb::prefetch`] so the hot pages are in the page cache before traffic arrives.
+
+use std::{
+    collections::{HashMap, HashSet},
+    fs::{self, File},
+    hash::Hasher,
+    io::{self, BufReader, BufWriter, ErrorKind, Read, Write},
+    path::{Path, PathBuf},
+    sync::{
+        Arc, Mutex, OnceLock,
+        atomic::{AtomicBool, AtomicU64, Ordering::Relaxed},
+    },
+    thread::{self, JoinHandle},
+    time::{Duration, Instant},
+};
+
+use crate::{
+    CdbHash,
+    cdb::{Cdb, TableEntry, ValueLocation},
+    util::{ReaderAt, read_tuple},
+};
+
+/// Granularity of the slot pages kept in a profile and of prefetched ranges.
+pub const PROFILE_PAGE_SIZE: u64 = 4096;
+
+/// Bytes requested at a time while prefetching, so the rate limit applies within large
+/// ranges too and the portable fallback reads through a bounded buffer.
+const PREFETCH_CHUNK: u64 = 1 << 20;
+
+/// Distinct records a profile keeps; lookups of further records only count per table.
+const MAX_RECORDS: usize = 1 << 20;
+
+const MAGIC: &[u8; 8] = b"CDB64PRF";
+const VERSION: u64 = 1;
+
+/// Lookup sampling state embedded in every [`Cdb`]. It stays one empty pointer until
+/// [`Cdb::start_profiling`] allocates the sampler, so idle handles cost a load per lookup
+/// and no memory.
+pub(crate) struct Profiler(OnceLock<Box<Sampler>>);
+
+struct Sampler {
+    every: AtomicU64,
+    seen: AtomicU64,
+    state: Mutex<ProfileState>,
+}
+
+#[derive(Default)]
+struct ProfileState {
+    tables: Vec<u64>,
+    slot_pages: HashSet<u64>,
+    records: HashMap<u64, (u64, u64)>,
+}
+
+impl Profiler {
+    pub(crate) fn new() -> Self {
+        Profiler(OnceLock::new())
+    }
+
+    /// Decides whether this lookup is sampled and, if so, records its table and first slot.
+    #[inline]
+    pub(crate) fn sample(&self, table_idx: usize, slot_offset: u64) -> bool {
+        let Some(sampler) = self.0.get() else {
+            return false;
+        };
+        let every = sampler.every.load(Relaxed);
+        if every == 0 || !sampler.seen.fetch_add(1, Relaxed).is_multiple_of(every) {
+            return false;
+        }
+        let mut state = sampler.state.lock().unwrap_or_else(|e| e.into_inner());
+        if state.tables.is_empty() {
+            state.tables = vec![0; 256];
+        }
+        state.tables[table_idx] += 1;
+        state.slot_pages.insert(slot_offset / PROFILE_PAGE_SIZE);
+        true
+    }
+
+    /// Records the record found by a sampled lookup.
+    pub(crate) fn record(&self, key_len: u64, location: ValueLocation) {
+        let Some(sampler) = self.0.get() else {
+            return;
+        };
+        let start = location.offset - 16 - key_len;
+        let len = 16 + key_len + location.len;
+        let mut state = sampler.state.lock().unwrap_or_else(|e| e.into_inner());
+        let full = state.records.len() >= MAX_RECORDS;
+        if let Some(entry) = state.records.get_mut(&start) {
+            entry.1 += 1;
+        } else if !full {
+            state.records.insert(start, (len, 1));
+        }
+    }
+}
+
+/// Lookups sampled from a [`Cdb`], as returned by [`Cdb::take_profile`].
+///
+/// Slot pages and record offsets are only meaningful for the file they were recorded
+/// from, which is identified by a digest of its header. [`Cdb::prefetch`] falls back to
+/// the hot tables, by index, when the profile is applied to a different file.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct AccessProfile {
+    /// Digest of the 4 KiB header of the profiled file.
+    pub header_digest: u64,
+    /// Sampled lookups per hash table, indexed by `hash & 0xff`.
+    pub tables: Vec<u64>,
+    /// Page numbers (of [`PROFILE_PAGE_SIZE`] bytes) holding the first probed slot.
+    pub slot_pages: Vec<u64>,
+    /// `(offset, length, hits)` of every sampled record, hottest first.
+    pub records: Vec<(u64, u64, u64)>,
+}
+
+impl AccessProfile {
+    /// Where the profile of the database at `path` is kept: `<path>.profile`.
+    pub fn sidecar_path(path: impl AsRef<Path>) -> PathBuf {
+        let mut name = path.as_ref().as_os_str().to_owned();
+        name.push(".profile");
+        PathBuf::from(name)
+    }
+
+    /// Writes the profile to the sidecar of `path`, replacing any previous one atomically.
+    pub fn save_sidecar(&self, path: impl AsRef<Path>) -> io::Result<()> {
+        let target = Self::sidecar_path(path);
+        let mut tmp = target.clone().into_os_string();
+        tmp.push(".tmp");
+        let mut out = BufWriter::new(File::create(&tmp)?);
+        self.write_to(&mut out)?;
+        out.into_inner().map_err(|e| e.into_error())?.sync_all()?;
+        fs::rename(&tmp, &target)
+    }
+
+    /// Reads the sidecar of `path`, or returns `None` if there is none.
+    pub fn load_sidecar(path: impl AsRef<Path>) -> io::Result<Option<Self>> {
+        match File::open(Self::sidecar_path(path)) {
+            Ok(file) => Self::read_from(&mut BufReader::new(file)).map(Some),
+            Err(e) if e.kind() == ErrorKind::NotFound => Ok(None),
+            Err(e) => Err(e),
+        }
+    }
+
+    /// Reads the keys of the sampled records back from `cdb`, the database the profile was
+    /// recorded from, paired with their hit counts and hottest first.
+    ///
+    /// The result can be passed to [`CdbWriter::set_hot_keys`](crate::CdbWriter::set_hot_keys)
+    /// when building the next version of the database.
+    ///
+    /// # Errors
+    ///
+    /// Returns an `InvalidInput` error if the profile was recorded from a different file.
+    pub fn hot_keys<R: ReaderAt, H>(&self, cdb: &Cdb<R, H>) -> io::Result<Vec<(Vec<u8>, u64)>> {
+        if self.header_digest != header_digest(&cdb.header) {
+            return Err(io::Error::new(
+                ErrorKind::InvalidInput,
+                "access profile was recorded from a different file",
+            ));
+        }
+        self.records
+            .iter()
+            .map(|&(offset, _, hits)| {
+                let (key_len, _) = read_tuple(&cdb.reader, offset)?;
+                let mut key = vec![0u8; key_len as usize];
+                cdb.reader.read_exact_at(&mut key, offset + 16)?;
+                Ok((key, hits))
+            })
+            .collect()
+    }
+
+    /// Serializes the profile: a magic number, a version and little-endian `u64` fields.
+    pub fn write_to(&self, out: &mut impl Write) -> io::Result<()> {
+        out.write_all(MAGIC)?;
+        let mut put = |v: u64| out.write_all(&v.to_le_bytes());
+        put(VERSION)?;
+        put(self.header_digest)?;
+        put(self.tables.len() as u64)?;
+        for &count in &self.tables {
+            put(count)?;
+        }
+        put(self.slot_pages.len() as u64)?;
+        for &page in &self.slot_pages {
+            put(page)?;
+        }
+        put(self.records.len() as u64)?;
+        for &(offset, len, hits) in &self.records {
+            put(offset)?;
+            put(len)?;
+            put(hits)?;
+        }
+        Ok(())
+    }
+
+    /// Parses a profile written by [`write_to`](Self::write_to).
+    pub fn read_from(input: &mut impl Read) -> io::Result<Self> {
+        let mut magic = [0u8; 8];
+        input.read_exact(&mut magic)?;
+        let mut get = || -> io::Result<u64> {
+            let mut buf = [0u8; 8];
+            input.read_exact(&mut buf)?;
+            Ok(u64::from_le_bytes(buf))
+        };
+        if &magic != MAGIC || get()? != VERSION {
+            return Err(io::Error::new(
+                ErrorKind::InvalidData,
+                "not a cdb64 access profile",
+            ));
+        }
+        let header_digest = get()?;
+        let table_count = get()?;
+        if table_count > 256 {
+            return Err(io::Error::new(
+                ErrorKind::InvalidData,
+                format!("access profile lists {table_count} tables, more than 256"),
+            ));
+        }
+        let tables = (0..table_count).map(|_| get()).collect::<io::Result<_>>()?;
+        let slot_pages = (0..get()?).map(|_| get()).collect::<io::Result<_>>()?;
+        let records = (0..get()?)
+            .map(|_| Ok((get()?, get()?, get()?)))
+            .collect::<io::Result<_>>()?;
+        Ok(AccessProfile {
+            header_digest,
+            tables,
+            slot_pages,
+            records,
+        })
+    }
+}
+
+/// How [`Cdb::prefetch`] pages a profile in.
+#[derive(Debug, Clone, Copy)]
+pub struct PrefetchOptions {
+    /// Upper bound on the bytes requested per second, so warm-up does not starve the
+    /// device of foreground reads.
+    pub bytes_per_sec: u64,
+}
+
+impl Default for PrefetchOptions {
+    fn default() -> Self {
+        PrefetchOptions {
+            bytes_per_sec: 256 << 20,
+        }
+    }
+}
+
+/// What a finished prefetch requested.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PrefetchStats {
+    /// Page-aligned ranges requested.
+    pub ranges: u64,
+    /// Bytes covered by those ranges.
+    pub bytes: u64,
+    /// Whether the profile matched this file, so slot pages and records were prefetched
+    /// rather than whole hot tables.
+    pub exact: bool,
+}
+
+/// A background prefetch started by [`Cdb::prefetch`]. Dropping it lets the prefetch
+/// run to completion on its own.
+pub struct Prefetch {
+    handle: JoinHandle<io::Result<PrefetchStats>>,
+    cancel: Arc<AtomicBool>,
+}
+
+impl Prefetch {
+    /// Waits for the prefetch to finish.
+    pub fn wait(self) -> io::Result<PrefetchStats> {
+        self.handle
+            .join()
+            .unwrap_or_else(|_| Err(io::Error::other("prefetch thread panicked")))
+    }
+
+    /// Asks the prefetch to stop after the current range.
+    pub fn cancel(&self) {
+        self.cancel.store(true, Relaxed);
+    }
+
+    /// Returns `true` once the prefetch has stopped.
+    pub fn is_finished(&self) -> bool {
+        self.handle.is_finished()
+    }
+}
+
+impl<R, H> Cdb<R, H> {
+    /// Starts sampling one in every `sample_every` lookups into an access profile.
+    ///
+    /// Sampled lookups take a lock, so keep the rate low on busy handles (1 in 100 to
+    /// 1 in 10 000). Passing `0` stops sampling. `get`, `locate` and the lookups built on
+    /// them are sampled; iteration is not.
+    pub fn start_profiling(&self, sample_every: u64) {
+        let sampler = match self.profiler.0.get() {
+            Some(sampler) => sampler,
+            None if sample_every == 0 => return,
+            None => self.profiler.0.get_or_init(|| {
+                Box::new(Sampler {
+                    every: AtomicU64::new(0),
+                    seen: AtomicU64::new(0),
+                    state: Mutex::new(ProfileState::default()),
+                })
+            }),
+        };
+        sampler.every.store(sample_every, Relaxed);
+    }
+
+    /// Returns the lookups sampled so far and starts a new profile.
+    ///
+    /// Records are ordered hottest first, and slot pages by page number.
+    pub fn take_profile(&self) -> AccessProfile {
+        let state = match self.profiler.0.get() {
+            Some(sampler) => {
+                std::mem::take(&mut *sampler.state.lock().unwrap_or_else(|e| e.into_inner()))
+            }
+            None => ProfileState::default(),
+        };
+        let mut slot_pages: Vec<u64> = state.slot_pages.into_iter().collect();
+        slot_pages.sort_unstable();
+        let mut records: Vec<(u64, u64, u64)> = state
+            .records
+            .into_iter()
+            .map(|(offset, (len, hits))| (offset, len, hits))
+            .collect();
+        records.sort_unstable_by(|a, b| b.2.cmp(&a.2).then(a.0.cmp(&b.0)));
+        AccessProfile {
+            header_digest: header_digest(&self.header),
+            tables: if state.tables.is_empty() {
+                vec![0; 256]
+            } else {
+                state.tables
+            },
+            slot_pages,
+            records,
+        }
+    }
+}
+
+impl<H: Hasher + Default> Cdb<File, H> {
+    /// Pages the ranges in `profile` into the OS page cache on a background thread.
+    ///
+    /// If the profile was recorded from this file, its slot pages are requested first,
+    /// then its records, hottest first. Otherwise, as after a rebuild, only the hash
+    /// tables that received sampled lookups are requested, by table index. On Linux the
+    /// ranges are handed to `posix_fadvise(POSIX_FADV_WILLNEED)`; elsewhere they are read
+    /// into a scratch buffer. Either way the page cache is shared, so both `open` and
+    /// `open_mmap` handles benefit. The request rate is capped by `options`.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{AccessProfile, Cdb, CdbWriter, CdbHash, PrefetchOptions};
+    /// use std::fs::File;
+    /// use tempfile::NamedTempFile;
+    ///
+    /// let file = NamedTempFile::new().unwrap();
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(File::create(file.path()).unwrap()).unwrap();
+    /// writer.put(b"key", b"value").unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// // While serving: sample lookups and save the profile next to the file.
+    /// let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+    /// cdb.start_profiling(1);
+    /// cdb.get(b"key").unwrap();
+    /// cdb.take_profile().save_sidecar(file.path()).unwrap();
+    ///
+    /// // After a restart: warm up in the background before taking traffic.
+    /// let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+    /// if let Some(profile) = AccessProfile::load_sidecar(file.path()).unwrap() {
+    ///     let stats = cdb.prefetch(&profile, PrefetchOptions::default()).unwrap().wait().unwrap();
+    ///     assert!(stats.exact && stats.bytes > 0);
+    /// }
+    /// # std::fs::remove_file(AccessProfile::sidecar_path(file.path())).unwrap();
+    /// ```
+    pub fn prefetch(
+        &self,
+        profile: &AccessProfile,
+        options: PrefetchOptions,
+    ) -> io::Result<Prefetch> {
+        let exact = profile.header_digest == header_digest(&self.header);
+        let file = self.reader.try_clone()?;
+        // Saturated extents from a corrupt header or profile end at the file's end.
+        let file_len = file.metadata()?.len();
+        let ranges: Vec<(u64, u64)> = prefetch_ranges(profile, &self.header, exact)
+            .into_iter()
+            .filter(|&(offset, _)| offset < file_len)
+            .map(|(offset, len)| (offset, len.min(file_len - offset)))
+            .collect();
+        let cancel = Arc::new(AtomicBool::new(false));
+        let stop = cancel.clone();
+        let handle = thread::Builder::new()
+            .name("cdb64-prefetch".into())
+            .spawn(move || {
+                let mut stats = PrefetchStats {
+                    exact,
+                    ..Default::default()
+                };
+                let started = Instant::now();
+                let rate = options.bytes_per_sec.max(PROFILE_PAGE_SIZE) as f64;
+                let mut scratch = Vec::new();
+                for (offset, len) in ranges {
+                    let mut done = 0;
+                    while done < len {
+                        if stop.load(Relaxed) {
+                            return Ok(stats);
+                        }
+                        let chunk = (len - done).min(PREFETCH_CHUNK);
+                        will_need(&file, offset + done, chunk, &mut scratch)?;
+                        done += chunk;
+                        stats.bytes += chunk;
+                        let due = Duration::from_secs_f64(stats.bytes as f64 / rate);
+                        if let Some(ahead) = due.checked_sub(started.elapsed()) {
+                            thread::sleep(ahead);
+                        }
+                    }
+                    stats.ranges += 1;
+                }
+                Ok(stats)
+            })?;
+        Ok(Prefetch { handle, cancel })
+    }
+
+    /// Loads the sidecar profile of `path`, if any, and starts [`prefetch`](Self::prefetch)
+    /// with default options. Call it right after `open` or `open_mmap`, or use
+    /// [`open_with_prefetch`](Self::open_with_prefetch), which does both.
+    pub fn prefetch_sidecar(&self, path: impl AsRef<Path>) -> io::Result<Option<Prefetch>> {
+        AccessProfile::load_sidecar(path)?
+            .map(|profile| self.prefetch(&profile, PrefetchOptions::default()))
+            .transpose()
+    }
+
+    /// Opens the database like [`open`](Self::open) and starts prefetching its sidecar
+    /// profile, if it has one. The prefetch runs in the background; the handle is usable
+    /// at once.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from opening the file, reading the sidecar or starting the
+    /// prefetch thread.
+    pub fn open_with_prefetch(path: impl AsRef<Path>) -> io::Result<(Self, Option<Prefetch>)> {
+        let cdb = Self::open(&path)?;
+        let prefetch = cdb.prefetch_sidecar(path)?;
+        Ok((cdb, prefetch))
+    }
+
+    /// Like [`open_with_prefetch`](Self::open_with_prefetch), but maps the file as
+    /// [`open_mmap`](Self::open_mmap) does.
+    ///
+    /// Only available with the `mmap` feature.
+    #[cfg(feature = "mmap")]
+    pub fn open_mmap_with_prefetch(path: impl AsRef<Path>) -> io::Result<(Self, Option<Prefetch>)> {
+        let cdb = Self::open_mmap(&path)?;
+        let prefetch = cdb.prefetch_sidecar(path)?;
+        Ok((cdb, prefetch))
+    }
+}
+
+fn header_digest(header: &[TableEntry; 256]) -> u64 {
+    let mut hasher = CdbHash::new();
+    for table in header {
+        hasher.write_u64(table.offset);
+        hasher.write_u64(table.length);
+    }
+    hasher.finish()
+}
+
+/// Page-aligned `(offset, len)` ranges to request, in order.
+fn prefetch_ranges(
+    profile: &AccessProfile,
+    header: &[TableEntry; 256],
+    exact: bool,
+) -> Vec<(u64, u64)> {
+    // Profiles and headers come from files, so extents saturate instead of overflowing.
+    let align = |start: u64, end: u64| {
+        let start = start / PROFILE_PAGE_SIZE * PROFILE_PAGE_SIZE;
+        let end = end
+            .div_ceil(PROFILE_PAGE_SIZE)
+            .saturating_mul(PROFILE_PAGE_SIZE);
+        (start, end.saturating_sub(start))
+    };
+    if !exact {
+        let mut hot: Vec<usize> = (0..profile.tables.len().min(256))
+            .filter(|&i| profile.tables[i] > 0 && header[i].length > 0)
+            .collect();
+        hot.sort_by_key(|&i| std::cmp::Reverse(profile.tables[i]));
+        return hot
+            .into_iter()
+            .map(|i| {
+                let table = &header[i];
+                align(
+                    table.offset,
+                    table.offset.saturating_add(table.length.saturating_mul(16)),
+                )
+            })
+            .collect();
+    }
+
+    // Coalesce runs of adjacent slot pages, then add records not already covered.
+    let mut ranges: Vec<(u64, u64)> = Vec::new();
+    for &page in &profile.slot_pages {
+        let page_start = page.saturating_mul(PROFILE_PAGE_SIZE);
+        match ranges.last_mut() {
+            Some((start, len)) if start.saturating_add(*len) == page_start => {
+                *len = len.saturating_add(PROFILE_PAGE_SIZE)
+            }
+            _ => ranges.push((page_start, PROFILE_PAGE_SIZE)),
+        }
+    }
+    let mut seen: HashSet<u64> = profile.slot_pages.iter().copied().collect();
+    for &(offset, len, _) in &profile.records {
+        let (start, len) = align(offset, offset.saturating_add(len));
+        let pages = start / PROFILE_PAGE_SIZE..(start + len) / PROFILE_PAGE_SIZE;
+        if pages.clone().all(|page| !seen.insert(page)) {
+            continue;
+        }
+        ranges.push((start, len));
+    }
+    ranges
+}
+
+#[cfg(target_os = "linux")]
+fn will_need(file: &File, offset: u64, len: u64, _scratch: &mut Vec<u8>) -> io::Result<()> {
+    use std::os::fd::AsRawFd;
+
+    let ret = unsafe {
+        libc::posix_fadvise(
+            file.as_raw_fd(),
+            offset as libc::off_t,
+            len as libc::off_t,
+            libc::POSIX_FADV_WILLNEED,
+        )
+    };
+    if ret != 0 {
+        return Err(io::Error::from_raw_os_error(ret));
+    }
+    Ok(())
+}
+
+#[cfg(not(target_os = "linux"))]
+fn will_need(file: &File, offset: u64, len: u64, scratch: &mut Vec<u8>) -> io::Result<()> {
+    scratch.resize(len.min(PREFETCH_CHUNK) as usize, 0);
+    let mut done = 0;
+    while done < len {
+        let n = (len - done).min(scratch.len() as u64) as usize;
+        match file.read_at(&mut scratch[..n], offset + done)? {
+            0 => break, // The range was rounded up past the end of the file.
+            n => done += n as u64,
+        }
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::CdbWriter;
+    use tempfile::NamedTempFile;
+
+    fn build(path: &Path, records: u64) {
+        let mut writer = CdbWriter::<_, CdbHash>::new(File::create(path).unwrap()).unwrap();
+        for i in 0..records {
+            writer
+                .put(format!("key{i}").as_bytes(), &vec![i as u8; 3000])
+                .unwrap();
+        }
+        writer.finalize().unwrap();
+    }
+
+    #[test]
+    fn test_profile_sampling_and_sidecar() {
+        let file = NamedTempFile::new().unwrap();
+        build(file.path(), 100);
+        let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+
+        cdb.get(b"key1").unwrap();
+        assert_eq!(cdb.take_profile().records, vec![]);
+        cdb.start_profiling(0);
+        assert!(
+            cdb.profiler.0.get().is_none(),
+            "no sampler until profiling starts"
+        );
+
+        cdb.start_profiling(1);
+        for key in [b"key7", b"key7", b"key3"] {
+            assert!(cdb.get(key).unwrap().is_some());
+        }
+        assert!(cdb.get(b"missing").unwrap().is_none());
+        let profile = cdb.take_profile();
+        // The miss is counted too, unless it hashes to an empty table.
+        assert!(profile.tables.iter().sum::<u64>() >= 3);
+        assert!(!profile.slot_pages.is_empty());
+        let location = cdb.locate(b"key7").unwrap().unwrap();
+        assert_eq!(
+            profile.records,
+            vec![
+                (location.offset - 16 - 4, 16 + 4 + 3000, 2),
+                (cdb.locate(b"key3").unwrap().unwrap().offset - 20, 3020, 1),
+            ]
+        );
+
+        profile.save_sidecar(file.path()).unwrap();
+        let loaded = AccessProfile::load_sidecar(file.path()).unwrap().unwrap();
+        assert_eq!(loaded, profile);
+        let (reopened, prefetch) = Cdb::<_, CdbHash>::open_with_prefetch(file.path()).unwrap();
+        assert!(prefetch.unwrap().wait().unwrap().exact);
+        assert!(reopened.get(b"key7").unwrap().is_some());
+        fs::remove_file(AccessProfile::sidecar_path(file.path())).unwrap();
+        assert!(AccessProfile::load_sidecar(file.path()).unwrap().is_none());
+        assert_eq!(
+            AccessProfile::read_from(&mut &b"CDB64XXX"[..])
+                .unwrap_err()
+                .kind(),
+            ErrorKind::InvalidData
+        );
+
+        // A table count over 256 is rejected rather than misparsing the fields after it.
+        let mut bytes = Vec::new();
+        profile.write_to(&mut bytes).unwrap();
+        bytes[24..32].copy_from_slice(&257u64.to_le_bytes());
+        let err = AccessProfile::read_from(&mut bytes.as_slice()).unwrap_err();
+        assert_eq!(err.kind(), ErrorKind::InvalidData);
+    }
+
+    #[test]
+    fn test_prefetch_exact_and_rebuilt() {
+        let file = NamedTempFile::new().unwrap();
+        build(file.path(), 100);
+        let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+        cdb.start_profiling(1);
+        cdb.get(b"key42").unwrap();
+        let profile = cdb.take_profile();
+
+        let stats = cdb
+            .prefetch(&profile, PrefetchOptions::default())
+            .unwrap()
+            .wait()
+            .unwrap();
+        assert!(stats.exact);
+        // One slot page plus the record, which spans one or two pages.
+        assert!(stats.ranges >= 1 && stats.bytes >= 2 * PROFILE_PAGE_SIZE);
+
+        // A rebuilt file has a different header: only the hot table is requested.
+        build(file.path(), 101);
+        let rebuilt = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+        let stats = rebuilt
+            .prefetch(&profile, PrefetchOptions::default())
+            .unwrap()
+            .wait()
+            .unwrap();
+        assert_eq!((stats.exact, stats.ranges), (false, 1));
+
+        // Corrupt extents saturate instead of overflowing.
+        let mut header = rebuilt.header;
+        let hot = (0..256).find(|&i| profile.tables[i] > 0).unwrap();
+        header[hot].length = u64::MAX;
+        let ranges = prefetch_ranges(&profile, &header, false);
+        assert_eq!(ranges.len(), 1);
+        let corrupt = AccessProfile {
+            slot_pages: vec![u64::MAX, u64::MAX],
+            records: vec![(u64::MAX - 1, u64::MAX, 1)],
+            ..profile
+        };
+        prefetch_ranges(&corrupt, &header, true);
+
+        // A prefetch clamps them to the file, so the request is valid and bounded.
+        let huge = AccessProfile {
+            header_digest: header_digest(&rebuilt.header),
+            records: vec![(PROFILE_PAGE_SIZE, u64::MAX, 1)],
+            ..corrupt
+        };
+        let file_len = fs::metadata(file.path()).unwrap().len();
+        let stats = rebuilt
+            .prefetch(&huge, PrefetchOptions::default())
+            .unwrap()
+            .wait()
+            .unwrap();
+        assert!(stats.exact && stats.bytes <= file_len);
+    }
+}
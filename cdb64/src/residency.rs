@@ -0,0 +1,254 @@
+//! Page-cache residency of an open database file.
+
+use std::{fs::File, hash::Hasher, io};
+
+use crate::cdb::{Cdb, HEADER_SIZE, TableEntry};
+
+/// Resident and total pages of one region of a CDB file.
+///
+/// A page that straddles two regions is counted in both.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct RegionResidency {
+    /// Pages of the region currently in the page cache.
+    pub resident_pages: u64,
+    /// Pages the region spans.
+    pub total_pages: u64,
+}
+
+impl RegionResidency {
+    /// The resident fraction, from `0.0` to `1.0`. An empty region counts as fully resident.
+    pub fn fraction(&self) -> f64 {
+        if self.total_pages == 0 {
+            1.0
+        } else {
+            self.resident_pages as f64 / self.total_pages as f64
+        }
+    }
+}
+
+/// Page-cache residency of a database, as returned by [`Cdb::residency`].
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct Residency {
+    /// The 4 KiB header of table pointers.
+    pub header: RegionResidency,
+    /// The records, between the header and the first hash table.
+    pub data: RegionResidency,
+    /// The 256 hash tables at the end of the file.
+    pub tables: RegionResidency,
+}
+
+impl<H: Hasher + Default> Cdb<File, H> {
+    /// Reports how much of the header, data section and hash tables is in the page cache.
+    ///
+    /// The file is mapped without being touched and checked with `mincore`, so this works
+    /// the same for `open` and `open_mmap` handles and never reads the file. Use it to hold
+    /// back traffic until a freshly deployed file is warm. Only supported on Unix; other
+    /// platforms return an `Unsupported` error.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::fs::File;
+    /// use tempfile::NamedTempFile;
+    ///
+    /// let file = NamedTempFile::new().unwrap();
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(File::create(file.path()).unwrap()).unwrap();
+    /// writer.put(b"key", b"value").unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+    /// # #[cfg(unix)]
+    /// # {
+    /// let residency = cdb.residency().unwrap();
+    /// if residency.tables.fraction() < 0.9 {
+    ///     println!("hash tables only {:.0}% cached", residency.tables.fraction() * 100.0);
+    /// }
+    /// # }
+    /// ```
+    pub fn residency(&self) -> io::Result<Residency> {
+        let pages = PageMap::of(&self.reader)?;
+        let (tables_start, tables_end) = tables_range(&self.header, pages.file_len);
+        Ok(Residency {
+            header: pages.region(0, HEADER_SIZE.min(pages.file_len)),
+            data: pages.region(HEADER_SIZE.min(tables_start), tables_start),
+            tables: pages.region(tables_start, tables_end),
+        })
+    }
+
+    /// Reports the residency of the hash tables that `keys` hash to.
+    ///
+    /// Pass the hottest keys to check that the tables they need are cached. Only the
+    /// hashes are computed; nothing is read from the file. Each table is counted once,
+    /// however many keys map to it.
+    pub fn table_residency_for_keys<'k>(
+        &self,
+        keys: impl IntoIterator<Item = &'k [u8]>,
+    ) -> io::Result<RegionResidency> {
+        let mut wanted = [false; 256];
+        for key in keys {
+            let mut hasher = H::default();
+            hasher.write(key);
+            wanted[(hasher.finish() & 0xff) as usize] = true;
+        }
+
+        let pages = PageMap::of(&self.reader)?;
+        let mut total = RegionResidency::default();
+        for (table, _) in self.header.iter().zip(wanted).filter(|(_, w)| *w) {
+            if table.length == 0 {
+                continue;
+            }
+            // Clamped like `tables_range`, so a corrupt header cannot overflow or count
+            // pages past the end of the file.
+            let end = table.offset.saturating_add(table.length.saturating_mul(16));
+            let region = pages.region(table.offset.min(pages.file_len), end.min(pages.file_len));
+            total.resident_pages += region.resident_pages;
+            total.total_pages += region.total_pages;
+        }
+        Ok(total)
+    }
+}
+
+/// `[start, end)` of the hash tables. `CdbWriter` writes them contiguously after the data.
+fn tables_range(header: &[TableEntry; 256], file_len: u64) -> (u64, u64) {
+    let tables = header.iter().filter(|table| table.length > 0);
+    let start = tables.clone().map(|table| table.offset).min();
+    let end = tables
+        .map(|table| table.offset.saturating_add(table.length.saturating_mul(16)))
+        .max();
+    match (start, end) {
+        (Some(start), Some(end)) => (start.min(file_len), end.min(file_len)),
+        _ => (file_len, file_len),
+    }
+}
+
+/// One residency flag per page of a file.
+struct PageMap {
+    resident: Vec<bool>,
+    page_size: u64,
+    file_len: u64,
+}
+
+impl PageMap {
+    #[cfg(unix)]
+    fn of(file: &File) -> io::Result<Self> {
+        use std::os::fd::AsRawFd;
+
+        let file_len = file.metadata()?.len();
+        let page_size = unsafe { libc::sysconf(libc::_SC_PAGESIZE) } as u64;
+        let len = usize::try_from(file_len).map_err(|_| io::Error::other("file too large"))?;
+        if len == 0 {
+            return Ok(PageMap {
+                resident: Vec::new(),
+                page_size,
+                file_len,
+            });
+        }
+
+        let mut flags = vec![0u8; len.div_ceil(page_size as usize)];
+        // SAFETY: the mapping is private to this function, never dereferenced, and unmapped
+        // before returning; `flags` has one byte per page of it, as mincore requires.
+        unsafe {
+            let addr = libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_SHARED,
+                file.as_raw_fd(),
+                0,
+            );
+            if addr == libc::MAP_FAILED {
+                return Err(io::Error::last_os_error());
+            }
+            let ret = libc::mincore(addr, len, flags.as_mut_ptr() as *mut _);
+            let err = io::Error::last_os_error();
+            libc::munmap(addr, len);
+            if ret != 0 {
+                return Err(err);
+            }
+        }
+        Ok(PageMap {
+            resident: flags.iter().map(|flag| flag & 1 != 0).collect(),
+            page_size,
+            file_len,
+        })
+    }
+
+    #[cfg(not(unix))]
+    fn of(_file: &File) -> io::Result<Self> {
+        Err(io::Error::new(
+            io::ErrorKind::Unsupported,
+            "page-cache residency is only supported on Unix",
+        ))
+    }
+
+    fn region(&self, start: u64, end: u64) -> RegionResidency {
+        if start >= end {
+            return RegionResidency::default();
+        }
+        let first = (start / self.page_size) as usize;
+        let last = ((end - 1) / self.page_size) as usize;
+        let pages =
+            &self.resident[first.min(self.resident.len())..(last + 1).min(self.resident.len())];
+        RegionResidency {
+            resident_pages: pages.iter().filter(|&&resident| resident).count() as u64,
+            total_pages: (last - first + 1) as u64,
+        }
+    }
+}
+
+#[cfg(all(test, unix))]
+mod tests {
+    use super::*;
+    use crate::{CdbHash, CdbWriter};
+    use tempfile::NamedTempFile;
+
+    #[test]
+    fn test_residency_regions() {
+        let file = NamedTempFile::new().unwrap();
+        let mut writer = CdbWriter::<_, CdbHash>::new(File::create(file.path()).unwrap()).unwrap();
+        let value = vec![7u8; 1000];
+        for i in 0..100 {
+            writer.put(format!("key{i}").as_bytes(), &value).unwrap();
+        }
+        writer.finalize().unwrap();
+
+        let cdb = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+        let residency = cdb.residency().unwrap();
+        let page = unsafe { libc::sysconf(libc::_SC_PAGESIZE) } as u64;
+        let data_len = 100 * (16 + 5 + 1000) - 10; // "key0".."key9" are one byte shorter
+        assert_eq!(residency.header.total_pages, HEADER_SIZE.div_ceil(page));
+        assert!(residency.data.total_pages >= data_len / page);
+        assert!(residency.tables.total_pages >= 1);
+        // A file that was just written is still in the page cache.
+        for region in [residency.header, residency.data, residency.tables] {
+            assert_eq!(region.resident_pages, region.total_pages);
+            assert_eq!(region.fraction(), 1.0);
+        }
+
+        let keys: Vec<&[u8]> = vec![b"key1", b"key2", b"key1"];
+        let hot = cdb.table_residency_for_keys(keys).unwrap();
+        assert!(hot.total_pages >= 1 && hot.total_pages <= residency.tables.total_pages);
+        assert_eq!(
+            cdb.table_residency_for_keys(std::iter::empty()).unwrap(),
+            RegionResidency::default()
+        );
+
+        // A table length that overflows `offset + length * 16` is clamped to the file.
+        let mut bytes = std::fs::read(file.path()).unwrap();
+        let table = cdb.header.iter().position(|t| t.length > 0).unwrap();
+        bytes[table * 16 + 8..table * 16 + 16].copy_from_slice(&u64::MAX.to_le_bytes());
+        std::fs::write(file.path(), &bytes).unwrap();
+        let corrupt = Cdb::<_, CdbHash>::open(file.path()).unwrap();
+        let key = (0..100)
+            .map(|i| format!("key{i}"))
+            .find(|key| {
+                let mut hasher = CdbHash::default();
+                hasher.write(key.as_bytes());
+                (hasher.finish() & 0xff) as usize == table
+            })
+            .unwrap();
+        let clamped = corrupt.table_residency_for_keys([key.as_bytes()]).unwrap();
+        assert!(clamped.total_pages <= (bytes.len() as u64).div_ceil(page));
+    }
+}
@@ -0,0 +1,241 @@
+//! Append-only scratch space for records that are written out later, in another order.
+//!
+//! Bytes stay in memory up to a budget and then move to an anonymous temporary file.
+
+use std::{
+    fs::{File, OpenOptions},
+    io::{self, BufWriter, Read, Seek, SeekFrom, Write},
+    path::PathBuf,
+    sync::atomic::{AtomicU64, Ordering::Relaxed},
+};
+
+use crate::util::ReaderAt;
+
+/// Default bytes kept in memory before spilling to a temporary file.
+pub const DEFAULT_SPILL_MEMORY: usize = 64 << 20;
+
+pub(crate) struct Spill {
+    memory: Vec<u8>,
+    file: Option<BufWriter<TempFile>>,
+    len: u64,
+    memory_limit: usize,
+}
+
+impl Spill {
+    pub(crate) fn new(memory_limit: usize) -> Self {
+        Spill {
+            memory: Vec::new(),
+            file: None,
+            len: 0,
+            memory_limit,
+        }
+    }
+
+    /// Total bytes appended.
+    pub(crate) fn len(&self) -> u64 {
+        self.len
+    }
+
+    pub(crate) fn append(&mut self, data: &[u8]) -> io::Result<()> {
+        self.reserve(data.len() as u64)?;
+        match &mut self.file {
+            Some(file) => file.write_all(data)?,
+            None => self.memory.extend_from_slice(data),
+        }
+        self.len += data.len() as u64;
+        Ok(())
+    }
+
+    /// Appends up to `len` bytes read from `reader` and returns how many there were.
+    pub(crate) fn append_from(&mut self, reader: impl Read, len: u64) -> io::Result<u64> {
+        self.reserve(len)?;
+        let copied = match &mut self.file {
+            // Past the buffer, straight into the file, so `io::copy` can move the bytes
+            // inside the kernel when `reader` is a file too.
+            Some(file) => {
+                file.flush()?;
+                io::copy(&mut reader.take(len), &mut file.get_mut().file)?
+            }
+            None => reader.take(len).read_to_end(&mut self.memory)? as u64,
+        };
+        self.len += copied;
+        Ok(copied)
+    }
+
+    /// Drops everything appended after the first `len` bytes.
+    pub(crate) fn truncate(&mut self, len: u64) -> io::Result<()> {
+        match &mut self.file {
+            Some(file) => {
+                file.flush()?;
+                let file = &mut file.get_mut().file;
+                file.set_len(len)?;
+                file.seek(SeekFrom::Start(len))?;
+            }
+            None => self.memory.truncate(len as usize),
+        }
+        self.len = len;
+        Ok(())
+    }
+
+    /// Moves the bytes to a temporary file if `additional` more would exceed the budget.
+    fn reserve(&mut self, additional: u64) -> io::Result<()> {
+        if self.file.is_none() && self.memory.len() as u64 + additional > self.memory_limit as u64 {
+            let mut file = BufWriter::with_capacity(1 << 20, TempFile::new()?);
+            file.write_all(&self.memory)?;
+            self.memory = Vec::new();
+            self.file = Some(file);
+        }
+        Ok(())
+    }
+
+    /// Makes everything appended so far readable; call it after the last append.
+    pub(crate) fn flush(&mut self) -> io::Result<()> {
+        match &mut self.file {
+            Some(file) => file.flush(),
+            None => Ok(()),
+        }
+    }
+
+    pub(crate) fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+        match &self.file {
+            Some(file) => file.get_ref().file.read_exact_at(buf, offset),
+            None => self.memory.as_slice().read_exact_at(buf, offset),
+        }
+    }
+
+    /// Writes everything appended to `out`, in order.
+    ///
+    /// A spilled file goes through `io::copy`, which on Linux moves the bytes inside the
+    /// kernel (`copy_file_range`, `splice` or `sendfile`) when `out` is a file, pipe or
+    /// socket.
+    pub(crate) fn write_all_to(&mut self, out: &mut impl Write) -> io::Result<()> {
+        self.flush()?;
+        match &self.file {
+            None => out.write_all(&self.memory),
+            Some(file) => {
+                let mut file = &file.get_ref().file;
+                file.seek(SeekFrom::Start(0))?;
+                let copied = io::copy(&mut file.take(self.len), out)?;
+                if copied != self.len {
+                    return Err(io::Error::new(
+                        io::ErrorKind::UnexpectedEof,
+                        "spill file is shorter than what was written to it",
+                    ));
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// Copies `len` bytes starting at `offset` to `out`, through `scratch`.
+    pub(crate) fn copy_to(
+        &self,
+        offset: u64,
+        len: u64,
+        out: &mut impl Write,
+        scratch: &mut Vec<u8>,
+    ) -> io::Result<()> {
+        if self.file.is_none() {
+            let start = offset as usize;
+            return out.write_all(&self.memory[start..start + len as usize]);
+        }
+        scratch.resize(scratch.len().max(64 << 10), 0);
+        let mut done = 0;
+        while done < len {
+            let n = (len - done).min(scratch.len() as u64) as usize;
+            self.read_exact_at(&mut scratch[..n], offset + done)?;
+            out.write_all(&scratch[..n])?;
+            done += n as u64;
+        }
+        Ok(())
+    }
+}
+
+/// A temporary file that is removed when dropped (on Unix, as soon as it is created).
+struct TempFile {
+    file: File,
+    path: Option<PathBuf>,
+}
+
+impl TempFile {
+    fn new() -> io::Result<Self> {
+        static COUNTER: AtomicU64 = AtomicU64::new(0);
+        let dir = std::env::temp_dir();
+        loop {
+            let path = dir.join(format!(
+                ".cdb64-spill-{}-{}",
+                std::process::id(),
+                COUNTER.fetch_add(1, Relaxed)
+            ));
+            let file = match OpenOptions::new()
+                .read(true)
+                .write(true)
+                .create_new(true)
+                .open(&path)
+            {
+                Ok(file) => file,
+                Err(e) if e.kind() == io::ErrorKind::AlreadyExists => continue,
+                Err(e) => return Err(e),
+            };
+            let path = if cfg!(unix) && std::fs::remove_file(&path).is_ok() {
+                None
+            } else {
+                Some(path)
+            };
+            return Ok(TempFile { file, path });
+        }
+    }
+}
+
+impl Write for TempFile {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        self.file.write(buf)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        self.file.flush()
+    }
+}
+
+impl Drop for TempFile {
+    fn drop(&mut self) {
+        if let Some(path) = &self.path {
+            let _ = std::fs::remove_file(path);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_spill_moves_to_file() {
+        let mut spill = Spill::new(10);
+        spill.append(b"hello").unwrap();
+        assert!(spill.file.is_none());
+        spill.append(b" spilled world").unwrap();
+        assert!(spill.file.is_some());
+        spill.flush().unwrap();
+        assert_eq!(spill.len(), 19);
+
+        let mut buf = [0u8; 7];
+        spill.read_exact_at(&mut buf, 6).unwrap();
+        assert_eq!(&buf, b"spilled");
+
+        let (mut out, mut scratch) = (Vec::new(), Vec::new());
+        spill.copy_to(3, 9, &mut out, &mut scratch).unwrap();
+        assert_eq!(out, b"lo spille");
+
+        out.clear();
+        spill.write_all_to(&mut out).unwrap();
+        assert_eq!(out, b"hello spilled world");
+
+        assert_eq!(spill.append_from(&b"!?"[..], 5).unwrap(), 2);
+        spill.truncate(20).unwrap();
+        spill.append(b"#").unwrap();
+        out.clear();
+        spill.write_all_to(&mut out).unwrap();
+        assert_eq!(out, b"hello spilled world!#");
+    }
+}
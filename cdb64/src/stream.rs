@@ -0,0 +1,187 @@
+//! A writer for sinks that cannot seek, such as pipes, sockets and compressors.
+
+use std::{hash::Hasher, io::Write, marker::PhantomData};
+
+use crate::{
+    Error,
+    cdb::HEADER_SIZE,
+    hash::CdbHash,
+    spill::{DEFAULT_SPILL_MEMORY, Spill},
+    writer::{Entry, append_record, emit_tables, encode_header, table_layout},
+};
+
+/// Creates a CDB database on any [`Write`] sink, strictly front to back.
+///
+/// [`CdbWriter`](crate::CdbWriter) needs `Seek`, because it fills in the header last.
+/// `CdbStreamWriter` instead spools the records until [`finalize`](Self::finalize), in
+/// memory up to a budget and in an unlinked temporary file beyond it, and then writes
+/// the header, the records and the hash tables in order. The output is byte-for-byte
+/// what `CdbWriter` would produce for the same `put` calls.
+///
+/// Spooled records are copied out with `io::copy`, which on Linux stays inside the
+/// kernel (`copy_file_range`, `splice` or `sendfile`) when the sink is a `File`, pipe or
+/// socket. Headers and tables are written in large blocks, so an unbuffered sink is
+/// fine.
+///
+/// # Examples
+///
+/// ```
+/// use cdb64::{Cdb, CdbHash, CdbStreamWriter};
+/// use std::io::Cursor;
+///
+/// // `Vec<u8>` implements `Write` but not `Seek`, like a pipe or a socket.
+/// let mut writer = CdbStreamWriter::<_, CdbHash>::new(Vec::new());
+/// writer.put(b"key", b"value").unwrap();
+/// writer.finalize().unwrap();
+/// let bytes: Vec<u8> = writer.into_inner().unwrap();
+///
+/// let cdb = Cdb::<_, CdbHash>::new(Cursor::new(bytes)).unwrap();
+/// assert_eq!(cdb.get(b"key").unwrap().unwrap(), b"value");
+/// ```
+pub struct CdbStreamWriter<W: Write, H: Hasher + Default = CdbHash> {
+    writer: W,
+    spill: Spill,
+    entries_by_table: [Vec<Entry>; 256],
+    is_finalized: bool,
+    _hasher: PhantomData<H>,
+}
+
+impl<W: Write, H: Hasher + Default> CdbStreamWriter<W, H> {
+    /// Creates a writer that keeps up to
+    /// [`DEFAULT_SPILL_MEMORY`](crate::DEFAULT_SPILL_MEMORY) bytes of records in memory.
+    /// Nothing is written to `writer` until `finalize`.
+    pub fn new(writer: W) -> Self {
+        Self::with_memory_budget(writer, DEFAULT_SPILL_MEMORY)
+    }
+
+    /// Creates a writer that keeps up to `memory_budget` bytes of records in memory and
+    /// spools the rest to a temporary file in [`std::env::temp_dir`].
+    pub fn with_memory_budget(writer: W, memory_budget: usize) -> Self {
+        CdbStreamWriter {
+            writer,
+            spill: Spill::new(memory_budget),
+            entries_by_table: [const { Vec::new() }; 256],
+            is_finalized: false,
+            _hasher: PhantomData,
+        }
+    }
+
+    /// Inserts a key-value pair; see [`CdbWriter::put`](crate::CdbWriter::put).
+    ///
+    /// # Errors
+    ///
+    /// Returns `Error::WriterFinalized` if called after `finalize()`, and `Error::Io` if
+    /// the records cannot be spooled.
+    pub fn put(&mut self, key: &[u8], value: &[u8]) -> Result<(), Error> {
+        if self.is_finalized {
+            return Err(Error::WriterFinalized);
+        }
+        let mut hasher = H::default();
+        hasher.write(key);
+        let hash_val = hasher.finish();
+
+        let offset = HEADER_SIZE + self.spill.len();
+        append_record(&mut self.spill, key, value)?;
+        self.entries_by_table[(hash_val & 0xff) as usize].push(Entry { hash_val, offset });
+        Ok(())
+    }
+
+    /// Writes the header, the spooled records and the hash tables to the sink, in that
+    /// order, and flushes it. Calling it again does nothing.
+    pub fn finalize(&mut self) -> Result<(), Error> {
+        if self.is_finalized {
+            return Ok(());
+        }
+
+        let tables = table_layout(
+            self.entries_by_table.iter().map(Vec::len),
+            HEADER_SIZE + self.spill.len(),
+        );
+        self.writer.write_all(&encode_header(&tables))?;
+        self.spill.write_all_to(&mut self.writer)?;
+        emit_tables(&self.entries_by_table, |table| self.writer.write_all(table))?;
+        self.writer.flush()?;
+
+        self.spill = Spill::new(0);
+        self.entries_by_table = [const { Vec::new() }; 256];
+        self.is_finalized = true;
+        Ok(())
+    }
+
+    /// Consumes the writer and returns the sink.
+    ///
+    /// # Errors
+    ///
+    /// Returns `Error::WriterNotFinalized` if `finalize()` has not been called yet.
+    pub fn into_inner(self) -> Result<W, Error> {
+        if !self.is_finalized {
+            return Err(Error::WriterNotFinalized);
+        }
+        Ok(self.writer)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{Cdb, CdbWriter};
+    use std::io::Cursor;
+
+    /// A sink that only implements `Write`, like a pipe.
+    struct Pipe(Vec<u8>);
+
+    impl Write for Pipe {
+        fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+            self.0.extend_from_slice(buf);
+            Ok(buf.len())
+        }
+
+        fn flush(&mut self) -> std::io::Result<()> {
+            Ok(())
+        }
+    }
+
+    #[test]
+    fn test_stream_writer_matches_cdb_writer() {
+        let records: Vec<(Vec<u8>, Vec<u8>)> = (0..3000)
+            .map(|i| (format!("key{i}").into_bytes(), vec![i as u8; i % 50]))
+            .chain([(b"key1".to_vec(), b"duplicate".to_vec()), (vec![], vec![])])
+            .collect();
+
+        let mut seekable = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+        // A small budget makes the records spill to a temporary file.
+        let mut streaming = CdbStreamWriter::<_, CdbHash>::with_memory_budget(Pipe(vec![]), 1000);
+        for (key, value) in &records {
+            seekable.put(key, value).unwrap();
+            streaming.put(key, value).unwrap();
+        }
+        seekable.finalize().unwrap();
+        assert!(matches!(
+            CdbStreamWriter::<_, CdbHash>::new(Pipe(vec![])).into_inner(),
+            Err(Error::WriterNotFinalized)
+        ));
+        streaming.finalize().unwrap();
+        streaming.finalize().unwrap();
+        assert!(matches!(
+            streaming.put(b"late", b""),
+            Err(Error::WriterFinalized)
+        ));
+
+        let expected = seekable.into_inner().unwrap().into_inner();
+        let streamed = streaming.into_inner().unwrap().0;
+        assert!(streamed == expected, "streamed output differs");
+
+        let cdb = Cdb::<_, CdbHash>::new(Cursor::new(streamed)).unwrap();
+        assert_eq!(cdb.get(b"key1").unwrap().unwrap(), vec![1u8]);
+        assert_eq!(cdb.get(b"").unwrap().unwrap(), b"");
+        assert_eq!(cdb.len(), records.len() as u64);
+    }
+
+    #[test]
+    fn test_stream_writer_empty() {
+        let mut streaming = CdbStreamWriter::<_, CdbHash>::new(Pipe(vec![]));
+        streaming.finalize().unwrap();
+        let data = streaming.into_inner().unwrap().0;
+        assert_eq!(data, vec![0u8; HEADER_SIZE as usize]);
+    }
+}
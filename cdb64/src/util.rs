@@ -69,6 +69,28 @@ impl ReaderAt for &'_ [u8] {
     }
 }
 
+/// Implement `ReaderAt` for owned buffers, such as the output of `CdbWriter::build_to_vec`.
+impl ReaderAt for Vec<u8> {
+    fn read_at(&self, buf: &mut [u8], offset: u64) -> Result<usize> {
+        self.as_slice().read_at(buf, offset)
+    }
+}
+
+/// Implement `ReaderAt` for boxed byte slices.
+impl ReaderAt for Box<[u8]> {
+    fn read_at(&self, buf: &mut [u8], offset: u64) -> Result<usize> {
+        (&**self).read_at(buf, offset)
+    }
+}
+
+/// Implement `ReaderAt` for shared byte slices, so one in-memory database can back
+/// several `Cdb` handles across threads.
+impl ReaderAt for std::sync::Arc<[u8]> {
+    fn read_at(&self, buf: &mut [u8], offset: u64) -> Result<usize> {
+        (&**self).read_at(buf, offset)
+    }
+}
+
 /// Implement `ReaderAt` for `std::io::Cursor<Vec<u8>>`.
 impl ReaderAt for std::io::Cursor<Vec<u8>> {
     fn read_at(&self, buf: &mut [u8], offset: u64) -> Result<usize> {
@@ -208,6 +230,20 @@ mod tests {
         assert_eq!(result.err().unwrap().kind(), ErrorKind::UnexpectedEof);
     }
 
+    #[test]
+    fn test_reader_at_owned_buffers() {
+        let data = vec![1u8, 2, 3, 4, 5];
+        let boxed: Box<[u8]> = data.clone().into_boxed_slice();
+        let shared: std::sync::Arc<[u8]> = data.clone().into();
+        let readers: [&dyn ReaderAt; 3] = [&data, &boxed, &shared];
+        for reader in readers {
+            let mut buf = [0u8; 2];
+            reader.read_exact_at(&mut buf, 3).unwrap();
+            assert_eq!(buf, [4, 5]);
+            assert_eq!(reader.read_at(&mut buf, 5).unwrap(), 0);
+        }
+    }
+
     // Tests for read_tuple
     #[test]
     fn test_read_tuple_success() {
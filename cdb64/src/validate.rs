@@ -0,0 +1,249 @@
+//! One-time structural checks that let lookups skip per-probe bounds checks and divisions.
+
+use std::{
+    hash::Hasher,
+    io::{self, ErrorKind},
+};
+
+use crate::{
+    cdb::{Cdb, HEADER_SIZE},
+    util::ReaderAt,
+};
+
+/// Slots read per `read_exact_at` while validating a table.
+const VALIDATE_CHUNK_SLOTS: u64 = 4096;
+
+/// Per-table state computed by [`Cdb::validated`].
+pub(crate) struct Validated {
+    /// Lemire's fastmod reciprocal of each table's slot count; 0 for empty tables.
+    pub(crate) reciprocals: [u128; 256],
+}
+
+/// The reciprocal `fastmod` needs for divisor `d`: `ceil(2^128 / d)`, wrapping to 0 for 1.
+pub(crate) fn fastmod_reciprocal(d: u64) -> u128 {
+    (u128::MAX / d as u128).wrapping_add(1)
+}
+
+/// `a % d` from three multiplications, given `m = fastmod_reciprocal(d)` (Lemire, Kaser and
+/// Kurz, "Faster Remainder by Direct Computation", 2019).
+#[inline]
+pub(crate) fn fastmod(a: u64, m: u128, d: u64) -> u64 {
+    let low = m.wrapping_mul(a as u128);
+    // The top 64 bits of the 192-bit product `low * d`.
+    let bottom = ((low as u64 as u128) * d as u128) >> 64;
+    let top = (low >> 64) * d as u128;
+    ((bottom + top) >> 64) as u64
+}
+
+impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
+    /// Checks the whole table structure once and switches lookups to a faster probe loop.
+    ///
+    /// Every non-empty hash table must start after the header and end inside the file (and
+    /// inside the mapping, for `open_mmap` handles), and every occupied slot must point at
+    /// a record header inside the file. All tables are read to check this, so the call
+    /// costs one sequential pass over them.
+    ///
+    /// Once validated, `get` and `locate` compute the start slot with a precomputed
+    /// reciprocal per table instead of a 64-bit division, wrap around with a compare
+    /// instead of a second one, and read slots from a mapping without bounds checks.
+    /// Results are identical; only the per-probe cost changes. Record keys and values are
+    /// still bounds-checked on every hit.
+    ///
+    /// # Errors
+    ///
+    /// Returns an `InvalidData` error naming the first table that fails a check, or any
+    /// I/O error from reading the tables.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    ///
+    /// let bytes = CdbWriter::<_, CdbHash>::build_to_vec(&[("key", "value")]).unwrap();
+    /// let cdb = Cdb::<_, CdbHash>::new(bytes).unwrap().validated().unwrap();
+    /// assert!(cdb.is_validated());
+    /// assert_eq!(cdb.get(b"key").unwrap().unwrap(), b"value");
+    /// ```
+    pub fn validated(mut self) -> io::Result<Self> {
+        let invalid = |table: usize, what: &str| {
+            io::Error::new(ErrorKind::InvalidData, format!("table {table}: {what}"))
+        };
+
+        let mut reciprocals = [0u128; 256];
+        let mut extents = Vec::new();
+        for (i, table) in self.header.iter().enumerate() {
+            if table.length == 0 {
+                continue;
+            }
+            let end = table
+                .length
+                .checked_mul(16)
+                .and_then(|bytes| table.offset.checked_add(bytes))
+                .ok_or_else(|| invalid(i, "extent overflows"))?;
+            if table.offset < HEADER_SIZE {
+                return Err(invalid(i, "overlaps the header"));
+            }
+            if self.mapped_len().is_some_and(|mapped| end > mapped) {
+                return Err(invalid(i, "ends past the end of the mapping"));
+            }
+            reciprocals[i] = fastmod_reciprocal(table.length);
+            extents.push((i, table.offset, table.length, end));
+        }
+
+        // Reading every table proves the file extends at least to the last table's end.
+        let file_end = extents
+            .iter()
+            .map(|&(.., end)| end)
+            .max()
+            .unwrap_or(HEADER_SIZE);
+        let mut buf = Vec::new();
+        for (i, offset, length, _) in extents {
+            let mut slot = 0;
+            while slot < length {
+                let n = (length - slot).min(VALIDATE_CHUNK_SLOTS);
+                buf.resize(n as usize * 16, 0);
+                self.reader
+                    .read_exact_at(&mut buf, offset + slot * 16)
+                    .map_err(|e| match e.kind() {
+                        ErrorKind::UnexpectedEof => invalid(i, "ends past the end of the file"),
+                        _ => e,
+                    })?;
+                for pair in buf.chunks_exact(16) {
+                    let hash = u64::from_le_bytes(pair[..8].try_into().unwrap());
+                    let data_offset = u64::from_le_bytes(pair[8..].try_into().unwrap());
+                    if hash == 0 && data_offset == 0 {
+                        continue;
+                    }
+                    if data_offset < HEADER_SIZE || data_offset.saturating_add(16) > file_end {
+                        return Err(invalid(i, "slot points outside the file"));
+                    }
+                }
+                slot += n;
+            }
+        }
+
+        self.validated = Some(Box::new(Validated { reciprocals }));
+        Ok(self)
+    }
+
+    /// Returns `true` if [`validated`](Self::validated) has checked this database.
+    pub fn is_validated(&self) -> bool {
+        self.validated.is_some()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{CdbHash, CdbWriter};
+
+    #[test]
+    fn test_fastmod_matches_remainder() {
+        fn next(x: &mut u64) -> u64 {
+            *x ^= *x << 13;
+            *x ^= *x >> 7;
+            *x ^= *x << 17;
+            *x
+        }
+        let mut x = 0x9e37_79b9_7f4a_7c15u64;
+        let divisors = [
+            1,
+            2,
+            3,
+            7,
+            10,
+            1 << 20,
+            (1 << 32) + 1,
+            u64::MAX >> 8,
+            u64::MAX,
+        ];
+        let random: Vec<u64> = (0..200)
+            .map(|_| (next(&mut x) >> (next(&mut x) % 64)) | 1)
+            .collect();
+        for d in divisors.into_iter().chain(random) {
+            let m = fastmod_reciprocal(d);
+            for a in [0, 1, d - 1, d, u64::MAX >> 8, u64::MAX]
+                .into_iter()
+                .chain((0..50).map(|_| next(&mut x)))
+            {
+                assert_eq!(fastmod(a, m, d), a % d, "{a} % {d}");
+            }
+        }
+    }
+
+    #[test]
+    fn test_validated_lookups_and_corruption() {
+        let records: Vec<(Vec<u8>, Vec<u8>)> = (0..3000)
+            .map(|i| {
+                (
+                    format!("key{i}").into_bytes(),
+                    format!("value{i}").into_bytes(),
+                )
+            })
+            .chain([(b"key7".to_vec(), b"duplicate".to_vec()), (vec![], vec![])])
+            .collect();
+        let bytes = CdbWriter::<_, CdbHash>::build_to_vec(&records).unwrap();
+
+        let plain = Cdb::<_, CdbHash>::new(bytes.as_slice()).unwrap();
+        let fast = Cdb::<_, CdbHash>::new(bytes.as_slice())
+            .unwrap()
+            .validated()
+            .unwrap();
+        assert!(fast.is_validated() && !plain.is_validated());
+        for i in 0..3500 {
+            let key = format!("key{i}");
+            assert_eq!(
+                fast.locate(key.as_bytes()).unwrap(),
+                plain.locate(key.as_bytes()).unwrap()
+            );
+        }
+        assert_eq!(fast.get(b"key7").unwrap().unwrap(), b"value7");
+        assert_eq!(fast.get(b"").unwrap().unwrap(), b"");
+
+        #[cfg(feature = "mmap")]
+        {
+            let file = tempfile::NamedTempFile::new().unwrap();
+            std::fs::write(file.path(), &bytes).unwrap();
+            let mapped = Cdb::<_, CdbHash>::open_mmap(file.path())
+                .unwrap()
+                .validated()
+                .unwrap();
+            for i in (0..3500).step_by(7) {
+                let key = format!("key{i}");
+                assert_eq!(
+                    mapped.locate(key.as_bytes()).unwrap(),
+                    plain.locate(key.as_bytes()).unwrap()
+                );
+            }
+        }
+
+        let table = (0..256).find(|&i| plain.header[i].length > 0).unwrap();
+        let corrupt = |patch: &dyn Fn(&mut Vec<u8>)| {
+            let mut bytes = bytes.clone();
+            patch(&mut bytes);
+            Cdb::<_, CdbHash>::new(bytes)
+                .unwrap()
+                .validated()
+                .err()
+                .unwrap()
+        };
+
+        let err = corrupt(&|b| b.truncate(b.len() - 8));
+        assert_eq!(err.kind(), ErrorKind::InvalidData);
+        let err = corrupt(&|b| b[table * 16..table * 16 + 8].copy_from_slice(&16u64.to_le_bytes()));
+        assert!(err.to_string().contains("overlaps the header"), "{err}");
+        let err = corrupt(&|b| {
+            b[table * 16 + 8..table * 16 + 16].copy_from_slice(&u64::MAX.to_le_bytes())
+        });
+        assert!(err.to_string().contains("overflows"), "{err}");
+        let slots = plain.header[table].offset as usize;
+        let err = corrupt(&|b| {
+            let slot = (0..)
+                .map(|s| slots + s * 16)
+                .find(|&s| b[s + 8..s + 16] != [0; 8])
+                .unwrap();
+            b[slot + 8..slot + 16].copy_from_slice(&(1u64 << 40).to_le_bytes());
+        });
+        assert!(err.to_string().contains("slot points outside"), "{err}");
+    }
+}
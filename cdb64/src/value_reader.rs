@@ -0,0 +1,361 @@
+//! Streaming access to a single value, for values too large to read into memory at once.
+
+use std::{
+    hash::Hasher,
+    io::{self, Read, Seek, SeekFrom},
+};
+
+use crate::{
+    cdb::{Cdb, ValueLocation},
+    util::ReaderAt,
+};
+
+/// A `Read + Seek` view of one value, as returned by [`Cdb::get_reader`].
+///
+/// Reads go straight to the database's `ReaderAt` (or its mapping, when opened with
+/// `open_mmap`) at the value's offset and never run past the end of the value. Position
+/// 0 is the first value byte. The reader holds no buffer of its own, so wrap it in a
+/// `BufReader` for many small reads; to copy it elsewhere, `io::copy` with a large
+/// buffer is enough.
+pub struct ValueReader<'a, R, H> {
+    cdb: &'a Cdb<R, H>,
+    location: ValueLocation,
+    pos: u64,
+}
+
+impl<R, H> std::fmt::Debug for ValueReader<'_, R, H> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("ValueReader")
+            .field("location", &self.location)
+            .field("pos", &self.pos)
+            .finish()
+    }
+}
+
+impl<R, H> ValueReader<'_, R, H> {
+    /// Length of the value in bytes.
+    pub fn len(&self) -> u64 {
+        self.location.len
+    }
+
+    /// Returns `true` if the value is empty.
+    pub fn is_empty(&self) -> bool {
+        self.location.len == 0
+    }
+
+    /// Where the value is stored in the file.
+    pub fn location(&self) -> ValueLocation {
+        self.location
+    }
+}
+
+impl<R: ReaderAt, H: Hasher + Default> Read for ValueReader<'_, R, H> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let remaining = self.location.len.saturating_sub(self.pos);
+        let want = (buf.len() as u64).min(remaining) as usize;
+        if want == 0 {
+            return Ok(0);
+        }
+        let n = self
+            .cdb
+            .read_at(&mut buf[..want], self.location.offset + self.pos)?;
+        if n == 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::UnexpectedEof,
+                "file ends before the value does",
+            ));
+        }
+        self.pos += n as u64;
+        Ok(n)
+    }
+}
+
+impl<R, H> Seek for ValueReader<'_, R, H> {
+    fn seek(&mut self, pos: SeekFrom) -> io::Result<u64> {
+        let (base, delta) = match pos {
+            SeekFrom::Start(n) => {
+                self.pos = n;
+                return Ok(n);
+            }
+            SeekFrom::End(delta) => (self.location.len, delta),
+            SeekFrom::Current(delta) => (self.pos, delta),
+        };
+        match base.checked_add_signed(delta) {
+            Some(n) => {
+                self.pos = n;
+                Ok(n)
+            }
+            None => Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "invalid seek to a negative or overflowing position",
+            )),
+        }
+    }
+
+    fn stream_position(&mut self) -> io::Result<u64> {
+        Ok(self.pos)
+    }
+}
+
+impl<R: ReaderAt, H: Hasher + Default> Cdb<R, H> {
+    /// Looks up `key` and returns a reader over its value instead of the value itself.
+    ///
+    /// The lookup is the same as [`get`](Self::get), but the value is read on demand, a
+    /// buffer at a time, so a value of hundreds of megabytes can be streamed to a socket
+    /// in constant memory and at the pace the socket accepts it.
+    ///
+    /// # Returns
+    ///
+    /// * `Ok(Some(ValueReader))` if the key is found.
+    /// * `Ok(None)` if the key is not found in the database.
+    /// * `Err(io::Error)` if an I/O error occurs during the lookup.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::{Cursor, Read, Seek, SeekFrom};
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer.put(b"key", b"a large value").unwrap();
+    /// writer.finalize().unwrap();
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap().into_inner()).unwrap();
+    ///
+    /// let mut reader = cdb.get_reader(b"key").unwrap().unwrap();
+    /// reader.seek(SeekFrom::Start(2)).unwrap();
+    /// let mut word = String::new();
+    /// reader.take(5).read_to_string(&mut word).unwrap();
+    /// assert_eq!(word, "large");
+    /// assert!(cdb.get_reader(b"missing").unwrap().is_none());
+    /// ```
+    pub fn get_reader(&self, key: &[u8]) -> io::Result<Option<ValueReader<'_, R, H>>> {
+        Ok(self
+            .locate(key)?
+            .map(|location| self.value_reader(location)))
+    }
+
+    /// Returns a reader over the value at a location previously returned by
+    /// [`locate`](Self::locate).
+    pub fn value_reader(&self, location: ValueLocation) -> ValueReader<'_, R, H> {
+        ValueReader {
+            cdb: self,
+            location,
+            pos: 0,
+        }
+    }
+}
+
+/// Bytes per `pread`/`write` round trip when `send_value` cannot stay in the kernel.
+#[cfg(unix)]
+const SEND_BUFFER: usize = 256 << 10;
+
+#[cfg(unix)]
+impl<H: Hasher + Default> Cdb<std::fs::File, H> {
+    /// Writes the value at `location` to `out`, keeping the bytes out of user space where
+    /// the platform allows.
+    ///
+    /// On Linux this is `sendfile` from the database file at the value's offset, so a
+    /// value can go to a socket, pipe or file without being copied through a buffer. It
+    /// uses `pread`-style offsets and never moves the file's cursor, so concurrent calls
+    /// on one `Cdb` are fine. Where `sendfile` is unavailable or `out` does not support it
+    /// (another platform, an `O_APPEND` file), the rest of the value is copied through a
+    /// buffer instead. Only available on Unix.
+    ///
+    /// `out` should be in blocking mode. On a non-blocking socket the call fails with
+    /// `WouldBlock` and the number of bytes already sent is lost; stream from
+    /// [`value_reader`](Cdb::value_reader) instead.
+    ///
+    /// # Errors
+    ///
+    /// Returns `UnexpectedEof` if the file ends before the value does, and any error from
+    /// writing to `out`.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::fs::File;
+    /// use tempfile::NamedTempFile;
+    ///
+    /// let db = NamedTempFile::new().unwrap();
+    /// let mut writer = CdbWriter::<File, CdbHash>::create(db.path()).unwrap();
+    /// writer.put(b"page", b"<html>...</html>").unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<File, CdbHash>::open(db.path()).unwrap();
+    /// let location = cdb.locate(b"page").unwrap().unwrap();
+    /// # #[cfg(unix)]
+    /// # {
+    /// // A `TcpStream` works the same way.
+    /// let mut out = tempfile::tempfile().unwrap();
+    /// assert_eq!(cdb.send_value(location, &mut out).unwrap(), 16);
+    /// # }
+    /// ```
+    pub fn send_value<W>(&self, location: ValueLocation, out: &mut W) -> io::Result<u64>
+    where
+        W: io::Write + std::os::fd::AsFd,
+    {
+        let sent = send_file(&self.reader, location, out)?;
+        let mut rest = self.value_reader(location);
+        rest.seek(SeekFrom::Start(sent))?;
+        let mut buf = vec![0u8; (location.len - sent).min(SEND_BUFFER as u64) as usize];
+        loop {
+            let n = rest.read(&mut buf)?;
+            if n == 0 {
+                return Ok(location.len);
+            }
+            out.write_all(&buf[..n])?;
+        }
+    }
+}
+
+/// Sends as much of the value as `sendfile` will take and returns how many bytes that was.
+#[cfg(target_os = "linux")]
+fn send_file(
+    file: &std::fs::File,
+    location: ValueLocation,
+    out: &impl std::os::fd::AsFd,
+) -> io::Result<u64> {
+    use std::os::fd::AsRawFd;
+
+    let (in_fd, out_fd) = (file.as_raw_fd(), out.as_fd().as_raw_fd());
+    let mut sent = 0u64;
+    while sent < location.len {
+        let mut offset = (location.offset + sent) as libc::off_t;
+        // Linux transfers at most 0x7ffff000 bytes per call.
+        let count = (location.len - sent).min(0x7fff_f000) as usize;
+        match unsafe { libc::sendfile(out_fd, in_fd, &mut offset, count) } {
+            0 => {
+                return Err(io::Error::new(
+                    io::ErrorKind::UnexpectedEof,
+                    "file ends before the value does",
+                ));
+            }
+            n if n > 0 => sent += n as u64,
+            _ => {
+                let err = io::Error::last_os_error();
+                match err.raw_os_error() {
+                    Some(libc::EINTR) => {}
+                    // `out` (or the file system) does not support sendfile.
+                    Some(libc::EINVAL | libc::ENOSYS | libc::EOPNOTSUPP) => return Ok(sent),
+                    _ => return Err(err),
+                }
+            }
+        }
+    }
+    Ok(sent)
+}
+
+#[cfg(all(unix, not(target_os = "linux")))]
+fn send_file(
+    _file: &std::fs::File,
+    _location: ValueLocation,
+    _out: &impl std::os::fd::AsFd,
+) -> io::Result<u64> {
+    Ok(0)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{CdbHash, CdbWriter};
+
+    #[test]
+    fn test_value_reader_read_and_seek() {
+        let value: Vec<u8> = (0..100_000u32).map(|i| (i % 253) as u8).collect();
+        let mut writer = CdbWriter::<_, CdbHash>::new(io::Cursor::new(Vec::new())).unwrap();
+        writer.put(b"big", &value).unwrap();
+        writer.put(b"empty", b"").unwrap();
+        writer.put(b"after", b"tail").unwrap();
+        writer.finalize().unwrap();
+        let data = writer.into_inner().unwrap().into_inner();
+        let cdb = Cdb::<_, CdbHash>::new(data.as_slice()).unwrap();
+
+        let mut reader = cdb.get_reader(b"big").unwrap().unwrap();
+        assert_eq!(reader.len(), value.len() as u64);
+        let mut chunk = [0u8; 7];
+        reader.read_exact(&mut chunk).unwrap();
+        assert_eq!(chunk, value[..7]);
+
+        assert_eq!(reader.seek(SeekFrom::End(-10)).unwrap(), 99_990);
+        let mut rest = Vec::new();
+        reader.read_to_end(&mut rest).unwrap();
+        assert_eq!(rest, value[99_990..], "reads stop at the end of the value");
+
+        assert_eq!(reader.seek(SeekFrom::Current(-20)).unwrap(), 99_980);
+        assert!(reader.seek(SeekFrom::Current(-100_000)).is_err());
+        reader.seek(SeekFrom::Start(200_000)).unwrap();
+        assert_eq!(reader.read(&mut chunk).unwrap(), 0);
+
+        let mut empty = cdb.get_reader(b"empty").unwrap().unwrap();
+        assert!(empty.is_empty());
+        assert_eq!(empty.read(&mut chunk).unwrap(), 0);
+        assert!(cdb.get_reader(b"missing").unwrap().is_none());
+
+        // A value running past the end of the file reports it instead of a clean EOF.
+        let mut cut = cdb.value_reader(ValueLocation {
+            offset: data.len() as u64 - 2,
+            len: 10,
+        });
+        let err = cut.read_to_end(&mut Vec::new()).unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::UnexpectedEof);
+
+        #[cfg(feature = "mmap")]
+        {
+            let file = tempfile::NamedTempFile::new().unwrap();
+            std::fs::write(file.path(), &data).unwrap();
+            let cdb = Cdb::<_, CdbHash>::open_mmap(file.path()).unwrap();
+            let mut streamed = Vec::new();
+            let mut reader = cdb.get_reader(b"big").unwrap().unwrap();
+            io::copy(&mut reader, &mut streamed).unwrap();
+            assert!(streamed == value);
+        }
+    }
+
+    #[cfg(unix)]
+    #[test]
+    fn test_send_value() {
+        use std::{fs::File, io::Write};
+
+        let value: Vec<u8> = (0..300_000u32).map(|i| (i % 241) as u8).collect();
+        let db = tempfile::NamedTempFile::new().unwrap();
+        let mut writer = CdbWriter::<File, CdbHash>::create(db.path()).unwrap();
+        writer.put(b"big", &value).unwrap();
+        writer.put(b"empty", b"").unwrap();
+        writer.finalize().unwrap();
+        let cdb = Cdb::<File, CdbHash>::open(db.path()).unwrap();
+        let location = cdb.locate(b"big").unwrap().unwrap();
+
+        // A plain file, a pipe, and an O_APPEND file, which sendfile refuses.
+        let out = tempfile::NamedTempFile::new().unwrap();
+        let mut file = File::create(out.path()).unwrap();
+        assert_eq!(cdb.send_value(location, &mut file).unwrap(), 300_000);
+        assert!(std::fs::read(out.path()).unwrap() == value);
+
+        let (mut rx, mut tx) = io::pipe().unwrap();
+        let drain = std::thread::spawn(move || {
+            let mut got = Vec::new();
+            rx.read_to_end(&mut got).unwrap();
+            got
+        });
+        cdb.send_value(location, &mut tx).unwrap();
+        drop(tx);
+        assert!(drain.join().unwrap() == value);
+
+        let mut append = File::options().append(true).open(out.path()).unwrap();
+        append.write_all(b"|").unwrap();
+        cdb.send_value(location, &mut append).unwrap();
+        let both = std::fs::read(out.path()).unwrap();
+        assert_eq!(both.len(), 600_001);
+        assert!(both[300_001..] == value[..]);
+
+        let empty = cdb.locate(b"empty").unwrap().unwrap();
+        assert_eq!(cdb.send_value(empty, &mut file).unwrap(), 0);
+        let past_end = ValueLocation {
+            offset: std::fs::metadata(db.path()).unwrap().len() - 4,
+            len: 8,
+        };
+        let err = cdb.send_value(past_end, &mut file).unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::UnexpectedEof);
+    }
+}
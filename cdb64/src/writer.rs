@@ -1,7 +1,8 @@
 use std::{
+    collections::HashMap,
     fs::{File, OpenOptions},
     hash::Hasher,
-    io::{Seek, SeekFrom, Write},
+    io::{self, Cursor, IoSlice, Read, Seek, SeekFrom, Write},
     marker::PhantomData,
     path::Path,
 };
@@ -10,13 +11,90 @@ use crate::{
     Error,
     cdb::{Cdb, HEADER_SIZE, TableEntry},
     hash::CdbHash,
+    spill::Spill,
     util::write_tuple,
 };
 
+/// How [`CdbWriter`] orders records in the data section. Set with
+/// [`CdbWriter::set_layout`]; readers handle every layout the same way.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum RecordLayout {
+    /// Records are written in `put` order as they arrive.
+    #[default]
+    PutOrder,
+    /// Records are held back and written at `finalize`, grouped by hash table and, within
+    /// a table, in slot order. The records behind neighbouring slots are then neighbours
+    /// on disk, so a probe sequence or a batch of lookups into one table touches few
+    /// pages, and readahead on a cold file fetches records that are likely to be needed.
+    ///
+    /// Up to `memory_budget` bytes of records are held in memory; the rest go to an
+    /// unlinked temporary file in [`std::env::temp_dir`].
+    TableClustered {
+        /// Bytes of records kept in memory before spilling to disk;
+        /// [`DEFAULT_SPILL_MEMORY`](crate::DEFAULT_SPILL_MEMORY) is a reasonable start.
+        memory_budget: usize,
+    },
+}
+
 #[derive(Debug)]
-struct Entry {
+pub(crate) struct Entry {
+    pub(crate) hash_val: u64,
+    pub(crate) offset: u64,
+}
+
+/// Places `entries` into a hash table of `num_slots` `(hash, offset)` slots by linear
+/// probing, in iteration order, so earlier entries get the shorter probe sequences.
+pub(crate) fn fill_table<'a>(
+    entries: impl IntoIterator<Item = &'a Entry>,
+    num_slots: usize,
+) -> Vec<(u64, u64)> {
+    let mut slots_data = vec![(0u64, 0u64); num_slots];
+    for entry in entries {
+        let mut slot_idx = (entry.hash_val >> 8) % (num_slots as u64);
+        loop {
+            if slots_data[slot_idx as usize].1 == 0 {
+                // .1 is offset, 0 means empty slot
+                slots_data[slot_idx as usize] = (entry.hash_val, entry.offset);
+                break;
+            }
+            slot_idx = (slot_idx + 1) % (num_slots as u64);
+        }
+    }
+    slots_data
+}
+
+/// The order in which a table's entries are inserted. Hot entries go first so they claim
+/// their home slots, except those whose hash an earlier non-hot `put` already used: they
+/// keep their place in put order, so `get` still returns the first value put for a key.
+fn insertion_order<'a>(hot: &'a [(usize, Entry)], others: &'a [Entry]) -> Vec<&'a Entry> {
+    let mut first_put: HashMap<u64, usize> = HashMap::new();
+    for (i, entry) in others.iter().enumerate() {
+        first_put.entry(entry.hash_val).or_insert(i);
+    }
+    let (mut in_put_order, first): (Vec<_>, Vec<_>) = hot
+        .iter()
+        .partition(|(seq, entry)| first_put.get(&entry.hash_val).is_some_and(|&i| i < *seq));
+    in_put_order.sort_by_key(|&(seq, _)| *seq);
+
+    let mut order: Vec<&Entry> = first.into_iter().map(|(_, entry)| entry).collect();
+    let mut in_put_order = in_put_order.into_iter().peekable();
+    for (i, entry) in others.iter().enumerate() {
+        while let Some((_, hot)) = in_put_order.next_if(|&&(seq, _)| seq <= i) {
+            order.push(hot);
+        }
+        order.push(entry);
+    }
+    order.extend(in_put_order.map(|(_, entry)| entry));
+    order
+}
+
+/// A record held back by [`CdbWriter::set_hot_keys`] until `finalize`.
+struct HotRecord {
     hash_val: u64,
-    offset: u64,
+    /// Non-hot entries already in this record's table when it was put.
+    seq: usize,
+    key: Vec<u8>,
+    value: Vec<u8>,
 }
 
 pub struct CdbWriter<W: Write + Seek, H: Hasher + Default = CdbHash> {
@@ -24,6 +102,15 @@ pub struct CdbWriter<W: Write + Seek, H: Hasher + Default = CdbHash> {
     entries_by_table: [Vec<Entry>; 256],
     is_finalized: bool,
     current_data_offset: u64,
+    hot_keys: HashMap<Vec<u8>, u64>,
+    hot_records: Vec<HotRecord>,
+    /// Records held back by `RecordLayout::TableClustered`. Their entries store
+    /// `HEADER_SIZE + spill offset`, so a stored offset is never zero.
+    spill: Option<Spill>,
+    /// End of the furthest partial record a failed `put_reader` left in the output.
+    partial_end: u64,
+    /// Cuts the output to a length, for writers that can; set by `create`.
+    truncate: Option<fn(&mut W, u64) -> io::Result<()>>,
     _hasher: PhantomData<H>,
 }
 
@@ -35,7 +122,9 @@ impl<H: Hasher + Default> CdbWriter<File, H> {
             .truncate(true)
             .open(path)?;
 
-        Self::new(file)
+        let mut writer = Self::new(file)?;
+        writer.truncate = Some(|file: &mut File, len| file.set_len(len));
+        Ok(writer)
     }
 }
 
@@ -50,10 +139,100 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
             entries_by_table: [const { Vec::new() }; 256],
             is_finalized: false,
             current_data_offset: HEADER_SIZE,
+            hot_keys: HashMap::new(),
+            hot_records: Vec::new(),
+            spill: None,
+            partial_end: 0,
+            truncate: None,
             _hasher: PhantomData,
         })
     }
 
+    /// Chooses how records are ordered in the data section; see [`RecordLayout`].
+    ///
+    /// # Errors
+    ///
+    /// Returns an `InvalidInput` I/O error once a record has been put, and
+    /// `Error::WriterFinalized` after `finalize()`.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash, RecordLayout, DEFAULT_SPILL_MEMORY};
+    /// use std::io::Cursor;
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer
+    ///     .set_layout(RecordLayout::TableClustered { memory_budget: DEFAULT_SPILL_MEMORY })
+    ///     .unwrap();
+    /// writer.put(b"key", b"value").unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    /// assert_eq!(cdb.get(b"key").unwrap().unwrap(), b"value");
+    /// ```
+    pub fn set_layout(&mut self, layout: RecordLayout) -> Result<(), Error> {
+        if self.is_finalized {
+            return Err(Error::WriterFinalized);
+        }
+        let empty = self.current_data_offset == HEADER_SIZE
+            && self.hot_records.is_empty()
+            && self.spill.as_ref().is_none_or(|spill| spill.len() == 0);
+        if !empty {
+            return Err(Error::Io(std::io::Error::new(
+                std::io::ErrorKind::InvalidInput,
+                "the record layout must be set before the first put",
+            )));
+        }
+        self.spill = match layout {
+            RecordLayout::PutOrder => None,
+            RecordLayout::TableClustered { memory_budget } => Some(Spill::new(memory_budget)),
+        };
+        Ok(())
+    }
+
+    /// Registers access-frequency hints for keys that will be `put` later.
+    ///
+    /// Records whose key has a non-zero weight are held in memory instead of being
+    /// written immediately. At `finalize` they are written as one contiguous block,
+    /// heaviest first, right after the other records and before the hash tables, so the
+    /// hot set occupies as few pages as possible. Their hash table entries are also
+    /// inserted before all others, so hot keys sit in (or nearest to) their home slot and
+    /// need the shortest probes. Puts of one key still keep their order, so `get` returns
+    /// the first value put: a hot key that was already put before the hints were set
+    /// gives up its home slot to that earlier record.
+    /// With [`RecordLayout::TableClustered`] records follow slot order instead, and only
+    /// the slot placement applies.
+    ///
+    /// Hints only apply to later `put` calls, and the held records cost memory until
+    /// `finalize`, so pass the hottest few percent of keys. They can come from
+    /// [`AccessProfile::hot_keys`](crate::AccessProfile::hot_keys) of the previous build.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::Cursor;
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer.set_hot_keys([(&b"popular"[..], 100), (b"trending", 10)]);
+    /// writer.put(b"popular", b"a").unwrap();
+    /// writer.put(b"cold", b"b").unwrap();
+    /// writer.put(b"trending", b"c").unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    /// let keys: Vec<_> = cdb.iter().map(|r| r.unwrap().0).collect();
+    /// assert_eq!(keys, [&b"cold"[..], b"popular", b"trending"]);
+    /// ```
+    pub fn set_hot_keys<K: AsRef<[u8]>>(&mut self, hints: impl IntoIterator<Item = (K, u64)>) {
+        for (key, weight) in hints {
+            if weight > 0 {
+                self.hot_keys.insert(key.as_ref().to_vec(), weight);
+            }
+        }
+    }
+
     /// Inserts a key-value pair into the CDB database.
     ///
     /// # Arguments
@@ -91,6 +270,27 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
             return Err(Error::WriterFinalized);
         }
 
+        let mut hasher = H::default();
+        hasher.write(key);
+        let hash_val = hasher.finish();
+
+        if self.hot_keys.contains_key(key) {
+            self.hot_records.push(HotRecord {
+                hash_val,
+                seq: self.entries_by_table[(hash_val & 0xff) as usize].len(),
+                key: key.to_vec(),
+                value: value.to_vec(),
+            });
+            return Ok(());
+        }
+
+        if let Some(spill) = &mut self.spill {
+            let offset = HEADER_SIZE + spill.len();
+            append_record(spill, key, value)?;
+            self.entries_by_table[(hash_val & 0xff) as usize].push(Entry { hash_val, offset });
+            return Ok(());
+        }
+
         self.writer
             .seek(SeekFrom::Start(self.current_data_offset))?;
         // Write key and value lengths as u64
@@ -98,9 +298,6 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
         self.writer.write_all(key)?;
         self.writer.write_all(value)?;
 
-        let mut hasher = H::default();
-        hasher.write(key);
-        let hash_val = hasher.finish();
         let table_idx = (hash_val & 0xff) as usize;
 
         self.entries_by_table[table_idx].push(Entry {
@@ -113,61 +310,242 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
         Ok(())
     }
 
-    fn write_footer_and_header(&mut self) -> Result<(), Error> {
+    /// Inserts a key whose value is the concatenation of `value`, without first copying
+    /// the pieces into one buffer.
+    ///
+    /// The record header, key and value pieces go to the underlying writer as one
+    /// vectored write where it supports them. Otherwise this behaves like
+    /// [`put`](Self::put).
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::{Cursor, IoSlice};
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// writer
+    ///     .put_vectored(b"greeting", &[IoSlice::new(b"hello, "), IoSlice::new(b"world")])
+    ///     .unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    /// assert_eq!(cdb.get(b"greeting").unwrap().unwrap(), b"hello, world");
+    /// ```
+    pub fn put_vectored(&mut self, key: &[u8], value: &[IoSlice<'_>]) -> Result<(), Error> {
         if self.is_finalized {
+            return Err(Error::WriterFinalized);
+        }
+        let value_len: u64 = value.iter().map(|slice| slice.len() as u64).sum();
+        let hash_val = self.hash(key);
+
+        if self.hot_keys.contains_key(key) {
+            let joined: Vec<u8> = value
+                .iter()
+                .flat_map(|slice| slice.iter().copied())
+                .collect();
+            return self.put(key, &joined);
+        }
+
+        let lens = record_lens(key.len() as u64, value_len);
+        if let Some(spill) = &mut self.spill {
+            let offset = HEADER_SIZE + spill.len();
+            spill.append(&lens)?;
+            spill.append(key)?;
+            for slice in value {
+                spill.append(slice)?;
+            }
+            self.entries_by_table[(hash_val & 0xff) as usize].push(Entry { hash_val, offset });
             return Ok(());
         }
 
-        self.writer.flush()?;
+        self.writer
+            .seek(SeekFrom::Start(self.current_data_offset))?;
+        let mut slices = Vec::with_capacity(value.len() + 2);
+        slices.extend([IoSlice::new(&lens), IoSlice::new(key)]);
+        slices.extend(value.iter().map(|slice| IoSlice::new(slice)));
+        write_all_vectored(&mut self.writer, &mut slices)?;
+        self.push_written(hash_val, 16 + key.len() as u64 + value_len);
+        Ok(())
+    }
 
-        let mut final_header_entries = [TableEntry::default(); 256];
-        let mut current_pos_for_hash_tables = self.current_data_offset;
+    /// Inserts a key whose value is the next `len` bytes of `value`, streamed into the
+    /// database rather than held in memory.
+    ///
+    /// The value is copied with `io::copy`, which on Linux uses `copy_file_range` when
+    /// both `value` and the underlying writer are files, so multi-gigabyte values never
+    /// pass through user space. Values of keys given to
+    /// [`set_hot_keys`](Self::set_hot_keys) are still read into memory, since hot records
+    /// are held until `finalize`; with [`RecordLayout::TableClustered`] the value is
+    /// streamed into the spill.
+    ///
+    /// # Errors
+    ///
+    /// Returns an `UnexpectedEof` I/O error if `value` ends before `len` bytes. The
+    /// partial record is not indexed, later records and the hash tables overwrite it, and
+    /// the writer stays usable. If it reached past the end of the finished database, a
+    /// writer from [`CdbWriter::create`] is truncated at `finalize`; other writers keep
+    /// those trailing bytes, which readers ignore.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::io::Cursor;
+    ///
+    /// let mut writer = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new())).unwrap();
+    /// let big = vec![7u8; 1 << 20];
+    /// writer.put_reader(b"blob", big.len() as u64, &big[..]).unwrap();
+    /// writer.finalize().unwrap();
+    ///
+    /// let cdb = Cdb::<_, CdbHash>::new(writer.into_inner().unwrap()).unwrap();
+    /// assert_eq!(cdb.get(b"blob").unwrap().unwrap().len(), 1 << 20);
+    /// ```
+    pub fn put_reader(&mut self, key: &[u8], len: u64, value: impl Read) -> Result<(), Error> {
+        if self.is_finalized {
+            return Err(Error::WriterFinalized);
+        }
+        let short = |copied: u64| {
+            Error::Io(io::Error::new(
+                io::ErrorKind::UnexpectedEof,
+                format!("value reader ended after {copied} of {len} bytes"),
+            ))
+        };
+        let hash_val = self.hash(key);
 
-        for (i, entries_in_this_table) in self.entries_by_table.iter().enumerate() {
-            if entries_in_this_table.is_empty() {
-                final_header_entries[i] = TableEntry {
-                    offset: 0,
-                    length: 0,
-                };
-                continue;
+        if self.hot_keys.contains_key(key) {
+            let mut buf = Vec::new();
+            let copied = value.take(len).read_to_end(&mut buf)? as u64;
+            if copied != len {
+                return Err(short(copied));
             }
+            return self.put(key, &buf);
+        }
 
-            let num_slots = entries_in_this_table.len() * 2;
-            let mut slots_data = vec![(0u64, 0u64); num_slots];
+        let lens = record_lens(key.len() as u64, len);
+        if let Some(spill) = &mut self.spill {
+            let start = spill.len();
+            spill.append(&lens)?;
+            spill.append(key)?;
+            let copied = spill.append_from(value, len)?;
+            if copied != len {
+                spill.truncate(start)?;
+                return Err(short(copied));
+            }
+            self.entries_by_table[(hash_val & 0xff) as usize].push(Entry {
+                hash_val,
+                offset: HEADER_SIZE + start,
+            });
+            return Ok(());
+        }
 
-            final_header_entries[i] = TableEntry {
-                offset: current_pos_for_hash_tables,
-                length: num_slots as u64, // num_slots is the count of (u64, u64) pairs
+        let start = self.current_data_offset;
+        self.writer.seek(SeekFrom::Start(start))?;
+        self.writer.write_all(&lens)?;
+        self.writer.write_all(key)?;
+        let copied = io::copy(&mut value.take(len), &mut self.writer);
+        if !matches!(copied, Ok(n) if n == len) {
+            // Nothing is indexed and `current_data_offset` stays put, so the next record or
+            // the hash tables overwrite the partial record. `finalize` cuts off any of it
+            // that reaches past them.
+            let end = self.writer.stream_position()?;
+            self.partial_end = self.partial_end.max(end);
+            self.writer.seek(SeekFrom::Start(start))?;
+            return Err(match copied {
+                Ok(copied) => short(copied),
+                Err(e) => Error::Io(e),
+            });
+        }
+        self.push_written(hash_val, 16 + key.len() as u64 + len);
+        Ok(())
+    }
+
+    fn hash(&self, key: &[u8]) -> u64 {
+        let mut hasher = H::default();
+        hasher.write(key);
+        hasher.finish()
+    }
+
+    /// Indexes the record of `len` bytes just written at `current_data_offset`.
+    fn push_written(&mut self, hash_val: u64, len: u64) {
+        self.entries_by_table[(hash_val & 0xff) as usize].push(Entry {
+            hash_val,
+            offset: self.current_data_offset,
+        });
+        self.current_data_offset += len;
+    }
+
+    fn write_footer_and_header(&mut self) -> Result<(), Error> {
+        if self.is_finalized {
+            return Ok(());
+        }
+
+        let hot_entries_by_table = self.write_hot_records()?;
+        self.writer.flush()?;
+
+        // With a clustered layout, records are copied from the spill table by table, in
+        // slot order, into the space before the hash tables.
+        let mut record_pos = HEADER_SIZE;
+        let mut scratch = Vec::new();
+        if let Some(spill) = &mut self.spill {
+            spill.flush()?;
+            self.current_data_offset = HEADER_SIZE + spill.len();
+        }
+
+        let tables = table_layout(
+            hot_entries_by_table
+                .iter()
+                .zip(&self.entries_by_table)
+                .map(|(hot, others)| hot.len() + others.len()),
+            self.current_data_offset,
+        );
+        let tables_end = tables_end(&tables, self.current_data_offset);
+
+        let mut encoded = Vec::new();
+        for ((hot_entries, entries_in_this_table), table) in hot_entries_by_table
+            .iter()
+            .zip(&self.entries_by_table)
+            .zip(&tables)
+            .filter(|(_, table)| table.length > 0)
+        {
+            let num_slots = table.length as usize;
+            let mut slots_data = if hot_entries.is_empty() {
+                fill_table(entries_in_this_table, num_slots)
+            } else {
+                fill_table(
+                    insertion_order(hot_entries, entries_in_this_table),
+                    num_slots,
+                )
             };
 
-            for entry in entries_in_this_table {
-                let mut slot_idx = (entry.hash_val >> 8) % (num_slots as u64);
-                loop {
-                    if slots_data[slot_idx as usize].1 == 0 {
-                        // .1 is offset, 0 means empty slot
-                        slots_data[slot_idx as usize] = (entry.hash_val, entry.offset);
-                        break;
-                    }
-                    slot_idx = (slot_idx + 1) % (num_slots as u64);
+            if let Some(spill) = &self.spill {
+                self.writer.seek(SeekFrom::Start(record_pos))?;
+                for slot in slots_data.iter_mut().filter(|slot| slot.1 != 0) {
+                    let spill_offset = slot.1 - HEADER_SIZE;
+                    let mut lens = [0u8; 16];
+                    spill.read_exact_at(&mut lens, spill_offset)?;
+                    let key_len = u64::from_le_bytes(lens[..8].try_into().unwrap());
+                    let value_len = u64::from_le_bytes(lens[8..].try_into().unwrap());
+                    let len = 16 + key_len + value_len;
+                    spill.copy_to(spill_offset, len, &mut self.writer, &mut scratch)?;
+                    slot.1 = record_pos;
+                    record_pos += len;
                 }
             }
 
-            self.writer
-                .seek(SeekFrom::Start(current_pos_for_hash_tables))?;
-            for (hash_val, data_offset) in slots_data {
-                // Write two u64 values directly
-                self.writer.write_all(&hash_val.to_le_bytes())?;
-                self.writer.write_all(&data_offset.to_le_bytes())?;
-            }
-            // Each slot is (u64, u64), so 16 bytes per slot. num_slots is the count of such slots.
-            current_pos_for_hash_tables += (num_slots as u64) * 16;
+            encoded.clear();
+            encode_table(&slots_data, &mut encoded);
+            self.writer.seek(SeekFrom::Start(table.offset))?;
+            self.writer.write_all(&encoded)?;
         }
 
+        self.spill = None;
         self.writer.seek(SeekFrom::Start(0))?;
-        for table_entry in final_header_entries.iter() {
-            // Write two u64 values directly for the header
-            self.writer.write_all(&table_entry.offset.to_le_bytes())?;
-            self.writer.write_all(&table_entry.length.to_le_bytes())?;
+        self.writer.write_all(&encode_header(&tables))?;
+        if let Some(truncate) = self.truncate
+            && self.partial_end > tables_end
+        {
+            truncate(&mut self.writer, tables_end)?;
         }
 
         self.is_finalized = true;
@@ -175,6 +553,57 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
         Ok(())
     }
 
+    /// Writes the records held back by `set_hot_keys`, heaviest first, at the end of the
+    /// data section and returns their hash table entries, each with its `HotRecord::seq`.
+    fn write_hot_records(&mut self) -> Result<[Vec<(usize, Entry)>; 256], Error> {
+        let mut entries: [Vec<(usize, Entry)>; 256] = [const { Vec::new() }; 256];
+        if self.hot_records.is_empty() {
+            return Ok(entries);
+        }
+        // Weights are looked up now, so every put of a key sorts the same and the stable
+        // sort keeps them in put order even if `set_hot_keys` changed a weight in between.
+        let mut records = std::mem::take(&mut self.hot_records);
+        records.sort_by_key(|record| std::cmp::Reverse(self.hot_keys[&record.key]));
+
+        if let Some(spill) = &mut self.spill {
+            // The clustered layout decides record placement; only the insertion order,
+            // which gives hot keys their home slots, still applies.
+            for record in records {
+                let offset = HEADER_SIZE + spill.len();
+                append_record(spill, &record.key, &record.value)?;
+                entries[(record.hash_val & 0xff) as usize].push((
+                    record.seq,
+                    Entry {
+                        hash_val: record.hash_val,
+                        offset,
+                    },
+                ));
+            }
+            return Ok(entries);
+        }
+
+        self.writer
+            .seek(SeekFrom::Start(self.current_data_offset))?;
+        for record in records {
+            write_tuple(
+                &mut self.writer,
+                record.key.len() as u64,
+                record.value.len() as u64,
+            )?;
+            self.writer.write_all(&record.key)?;
+            self.writer.write_all(&record.value)?;
+            entries[(record.hash_val & 0xff) as usize].push((
+                record.seq,
+                Entry {
+                    hash_val: record.hash_val,
+                    offset: self.current_data_offset,
+                },
+            ));
+            self.current_data_offset += 16 + record.key.len() as u64 + record.value.len() as u64;
+        }
+        Ok(entries)
+    }
+
     pub fn finalize(&mut self) -> Result<(), Error> {
         self.write_footer_and_header()?;
         self.writer.flush()?;
@@ -219,6 +648,205 @@ impl<W: Write + Seek, H: Hasher + Default> CdbWriter<W, H> {
     }
 }
 
+impl<H: Hasher + Default> CdbWriter<Cursor<Vec<u8>>, H> {
+    /// Builds a complete database in memory with a single, exactly sized allocation.
+    ///
+    /// The final size, `HEADER_SIZE + Σ(16 + key + value) + 16 · 2 · records`, is known
+    /// from the records up front, so the buffer is allocated once and the header, records
+    /// and tables are encoded straight into it, without the reallocations and `Seek`
+    /// calls of writing through a `Cursor`. The bytes are identical to those `CdbWriter`
+    /// produces for the same records in the same order. Open the result with
+    /// [`Cdb::new`] and share the `Cdb` itself behind an `Arc`; converting the bytes into
+    /// an `Arc<[u8]>` would copy them into a new allocation.
+    ///
+    /// # Errors
+    ///
+    /// Returns an `InvalidInput` I/O error if the database would not fit in memory.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// use cdb64::{Cdb, CdbWriter, CdbHash};
+    /// use std::sync::Arc;
+    ///
+    /// let records = [("apple", "red"), ("banana", "yellow")];
+    /// let bytes = CdbWriter::<_, CdbHash>::build_to_vec(&records).unwrap();
+    ///
+    /// let cdb = Arc::new(Cdb::<_, CdbHash>::new(bytes).unwrap());
+    /// assert_eq!(cdb.get(b"banana").unwrap().unwrap(), b"yellow");
+    /// ```
+    pub fn build_to_vec<K: AsRef<[u8]>, V: AsRef<[u8]>>(
+        records: &[(K, V)],
+    ) -> Result<Vec<u8>, Error> {
+        let plan = Plan::new::<H, _, _>(records);
+        let mut buf = Vec::new();
+        usize::try_from(plan.total)
+            .ok()
+            .and_then(|total| buf.try_reserve_exact(total).ok())
+            .ok_or_else(|| {
+                Error::Io(std::io::Error::new(
+                    std::io::ErrorKind::InvalidInput,
+                    "database does not fit in memory",
+                ))
+            })?;
+        plan.emit(records, |bytes| {
+            buf.extend_from_slice(bytes);
+            Ok(())
+        })?;
+        debug_assert_eq!(buf.len() as u64, plan.total);
+        Ok(buf)
+    }
+}
+
+/// The layout of a database whose records are all known up front, so it can be
+/// encoded front to back into a preallocated buffer or mapping.
+pub(crate) struct Plan {
+    entries_by_table: [Vec<Entry>; 256],
+    data_end: u64,
+    /// Size of the finished file in bytes.
+    pub(crate) total: u64,
+}
+
+impl Plan {
+    pub(crate) fn new<H: Hasher + Default, K: AsRef<[u8]>, V: AsRef<[u8]>>(
+        records: &[(K, V)],
+    ) -> Self {
+        let mut entries_by_table: [Vec<Entry>; 256] = [const { Vec::new() }; 256];
+        let mut data_end = HEADER_SIZE;
+        for (key, value) in records {
+            let (key, value) = (key.as_ref(), value.as_ref());
+            let mut hasher = H::default();
+            hasher.write(key);
+            let hash_val = hasher.finish();
+            entries_by_table[(hash_val & 0xff) as usize].push(Entry {
+                hash_val,
+                offset: data_end,
+            });
+            data_end += 16 + key.len() as u64 + value.len() as u64;
+        }
+        Plan {
+            entries_by_table,
+            data_end,
+            total: data_end + records.len() as u64 * 2 * 16,
+        }
+    }
+
+    /// Passes the encoded header, records and tables to `emit`, in file order.
+    /// `records` must be the slice the plan was made from.
+    pub(crate) fn emit<K: AsRef<[u8]>, V: AsRef<[u8]>>(
+        &self,
+        records: &[(K, V)],
+        mut emit: impl FnMut(&[u8]) -> std::io::Result<()>,
+    ) -> std::io::Result<()> {
+        let tables = table_layout(self.entries_by_table.iter().map(Vec::len), self.data_end);
+        emit(&encode_header(&tables))?;
+        for (key, value) in records {
+            let (key, value) = (key.as_ref(), value.as_ref());
+            emit(&record_lens(key.len() as u64, value.len() as u64))?;
+            emit(key)?;
+            emit(value)?;
+        }
+        emit_tables(&self.entries_by_table, emit)
+    }
+}
+
+/// Header entries for tables of `entry_counts[i]` entries each, with two slots per entry,
+/// stored back to back in table order from `start`. Empty tables get offset 0.
+pub(crate) fn table_layout(
+    entry_counts: impl IntoIterator<Item = usize>,
+    start: u64,
+) -> [TableEntry; 256] {
+    let mut tables = [TableEntry::default(); 256];
+    let mut pos = start;
+    for (table, count) in tables.iter_mut().zip(entry_counts) {
+        if count > 0 {
+            let length = count as u64 * 2;
+            *table = TableEntry {
+                offset: pos,
+                length,
+            };
+            pos += length * 16;
+        }
+    }
+    tables
+}
+
+/// Where the tables of a [`table_layout`] from `start` end, which is the end of the file.
+fn tables_end(tables: &[TableEntry; 256], start: u64) -> u64 {
+    start + tables.iter().map(|table| table.length * 16).sum::<u64>()
+}
+
+/// The 4 KiB header describing `tables`.
+pub(crate) fn encode_header(tables: &[TableEntry; 256]) -> Vec<u8> {
+    let mut header = Vec::with_capacity(HEADER_SIZE as usize);
+    for table in tables {
+        header.extend_from_slice(&table.offset.to_le_bytes());
+        header.extend_from_slice(&table.length.to_le_bytes());
+    }
+    header
+}
+
+/// Appends the `(hash, offset)` slots of one table to `out`, as stored on disk.
+pub(crate) fn encode_table(slots: &[(u64, u64)], out: &mut Vec<u8>) {
+    out.reserve(slots.len() * 16);
+    for (hash_val, data_offset) in slots {
+        out.extend_from_slice(&hash_val.to_le_bytes());
+        out.extend_from_slice(&data_offset.to_le_bytes());
+    }
+}
+
+/// Fills and encodes each non-empty table of `entries_by_table`, in the order
+/// [`table_layout`] places them, and passes each to `emit`.
+pub(crate) fn emit_tables(
+    entries_by_table: &[Vec<Entry>; 256],
+    mut emit: impl FnMut(&[u8]) -> io::Result<()>,
+) -> io::Result<()> {
+    let mut table = Vec::new();
+    for entries in entries_by_table
+        .iter()
+        .filter(|entries| !entries.is_empty())
+    {
+        table.clear();
+        encode_table(&fill_table(entries, entries.len() * 2), &mut table);
+        emit(&table)?;
+    }
+    Ok(())
+}
+
+/// The 16-byte record header: key length and value length, little-endian.
+fn record_lens(key_len: u64, value_len: u64) -> [u8; 16] {
+    let mut lens = [0u8; 16];
+    lens[..8].copy_from_slice(&key_len.to_le_bytes());
+    lens[8..].copy_from_slice(&value_len.to_le_bytes());
+    lens
+}
+
+/// Appends a record, header and all, to `spill`.
+pub(crate) fn append_record(spill: &mut Spill, key: &[u8], value: &[u8]) -> std::io::Result<()> {
+    spill.append(&record_lens(key.len() as u64, value.len() as u64))?;
+    spill.append(key)?;
+    spill.append(value)
+}
+
+/// `Write::write_all_vectored` is unstable; this is the same loop.
+fn write_all_vectored(writer: &mut impl Write, mut slices: &mut [IoSlice<'_>]) -> io::Result<()> {
+    IoSlice::advance_slices(&mut slices, 0);
+    while !slices.is_empty() {
+        match writer.write_vectored(slices) {
+            Ok(0) => {
+                return Err(io::Error::new(
+                    io::ErrorKind::WriteZero,
+                    "failed to write whole buffer",
+                ));
+            }
+            Ok(n) => IoSlice::advance_slices(&mut slices, n),
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(())
+}
+
 impl<H: Hasher + Default> CdbWriter<File, H> {
     /// Freezes the writer by finalizing it, flushing to disk, and reopening it as a `Cdb` reader.
     ///
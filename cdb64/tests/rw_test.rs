@@ -202,3 +202,311 @@ fn test_freeze_custom_hasher() -> Result<(), Error> {
     assert!(cdb_custom.get(b"nonexistent_freeze_custom")?.is_none());
     Ok(())
 }
+
+/// Reads the data offset stored in the home slot of `key`, straight from the file bytes.
+fn home_slot_offset(data: &[u8], key: &[u8]) -> u64 {
+    let u64_at = |pos: usize| u64::from_le_bytes(data[pos..pos + 8].try_into().unwrap());
+    let mut hasher = CdbHash::default();
+    hasher.write(key);
+    let hash = hasher.finish();
+    let table = (hash & 0xff) as usize;
+    let (offset, length) = (u64_at(table * 16), u64_at(table * 16 + 8));
+    let slot = offset + ((hash >> 8) % length) * 16;
+    u64_at(slot as usize + 8)
+}
+
+#[test]
+fn test_hot_key_layout() -> Result<(), Error> {
+    let temp_file = NamedTempFile::new().expect("Failed to create temporary file");
+    let file_path = temp_file.path();
+
+    // Sample the previous build's lookups to find the hot keys.
+    let mut writer = CdbWriter::<_, CdbHash>::create(file_path)?;
+    for i in 0..1000 {
+        writer.put(format!("key{i}").as_bytes(), format!("old{i}").as_bytes())?;
+    }
+    let old = writer.freeze(file_path)?;
+    old.start_profiling(1);
+    for (key, hits) in [("key500", 3), ("key7", 2), ("key900", 1)] {
+        for _ in 0..hits {
+            old.get(key.as_bytes())?;
+        }
+    }
+    let hints = old.take_profile().hot_keys(&old)?;
+    assert_eq!(hints[0], (b"key500".to_vec(), 3));
+
+    let mut writer = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+    writer.set_hot_keys(hints);
+    for i in 0..1000 {
+        writer.put(format!("key{i}").as_bytes(), format!("new{i}").as_bytes())?;
+    }
+    writer.put(b"key7", b"duplicate")?;
+    writer.finalize()?;
+    let data = writer.into_inner()?.into_inner();
+    let cdb = Cdb::<_, CdbHash>::new(std::io::Cursor::new(data.clone()))?;
+
+    for i in 0..1000 {
+        let value = cdb.get(format!("key{i}").as_bytes())?.unwrap();
+        assert_eq!(value, format!("new{i}").as_bytes());
+    }
+
+    // The hot records form one block, hottest first, after the others.
+    let tail: Vec<(Vec<u8>, Vec<u8>)> = cdb.iter().skip(997).collect::<Result<_, _>>()?;
+    let expected: Vec<(&[u8], &[u8])> = vec![
+        (b"key500", b"new500"),
+        (b"key7", b"new7"),
+        (b"key7", b"duplicate"),
+        (b"key900", b"new900"),
+    ];
+    assert_eq!(
+        tail.iter()
+            .map(|(k, v)| (k.as_slice(), v.as_slice()))
+            .collect::<Vec<_>>(),
+        expected
+    );
+
+    // Each hot key won its home slot.
+    for key in [&b"key500"[..], b"key7", b"key900"] {
+        let location = cdb.locate(key)?.unwrap();
+        assert_eq!(
+            home_slot_offset(&data, key),
+            location.offset - 16 - key.len() as u64
+        );
+    }
+    Ok(())
+}
+
+#[test]
+fn test_hot_key_duplicates_keep_first_put() -> Result<(), Error> {
+    for clustered in [false, true] {
+        let mut writer = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+        if clustered {
+            writer.set_layout(cdb64::RecordLayout::TableClustered {
+                memory_budget: 4096,
+            })?;
+        }
+        for i in 0..500 {
+            writer.put(format!("key{i}").as_bytes(), b"first")?;
+        }
+        // Keys already put before the hints, and hot keys whose weight changes between
+        // puts, still return the value that was put first.
+        writer.set_hot_keys((0..500).step_by(5).map(|i| (format!("key{i}"), 1)));
+        writer.set_hot_keys([("fresh", 1)]);
+        writer.put(b"fresh", b"first")?;
+        writer.set_hot_keys([("fresh", 9)]);
+        for i in (0..500).step_by(5) {
+            writer.put(format!("key{i}").as_bytes(), b"second")?;
+        }
+        writer.put(b"fresh", b"second")?;
+        writer.finalize()?;
+
+        let cdb = Cdb::<_, CdbHash>::new(writer.into_inner()?)?;
+        for i in 0..500 {
+            let key = format!("key{i}");
+            assert_eq!(cdb.get(key.as_bytes())?.unwrap(), b"first", "{key}");
+        }
+        assert_eq!(cdb.get(b"fresh")?.unwrap(), b"first");
+        assert_eq!(cdb.iter().count(), 500 + 100 + 2);
+    }
+    Ok(())
+}
+
+#[test]
+fn test_table_clustered_layout() -> Result<(), Error> {
+    let mut writer = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+    // A small budget makes the records spill to a temporary file.
+    writer.set_layout(cdb64::RecordLayout::TableClustered {
+        memory_budget: 4096,
+    })?;
+    writer.set_hot_keys([(b"key42", 1)]);
+    for i in 0..2000 {
+        writer.put(format!("key{i}").as_bytes(), format!("value{i}").as_bytes())?;
+    }
+    writer.put(b"key7", b"duplicate")?;
+    assert!(matches!(
+        writer.set_layout(cdb64::RecordLayout::PutOrder),
+        Err(Error::Io(_))
+    ));
+    writer.finalize()?;
+    let data = writer.into_inner()?.into_inner();
+    let cdb = Cdb::<_, CdbHash>::new(std::io::Cursor::new(data.clone()))?;
+
+    for i in 0..2000 {
+        let value = cdb.get(format!("key{i}").as_bytes())?.unwrap();
+        assert_eq!(value, format!("value{i}").as_bytes());
+    }
+    assert!(cdb.get(b"key2000")?.is_none());
+    assert_eq!(
+        home_slot_offset(&data, b"key42") + 16 + 5,
+        cdb.locate(b"key42")?.unwrap().offset
+    );
+
+    // Records come out grouped by table, in slot order.
+    let table_of = |key: &[u8]| {
+        let mut hasher = CdbHash::default();
+        hasher.write(key);
+        hasher.finish() & 0xff
+    };
+    let tables: Vec<u64> = cdb
+        .iter()
+        .map(|record| record.map(|(key, _)| table_of(&key)))
+        .collect::<Result<_, _>>()?;
+    assert_eq!(tables.len(), 2001);
+    assert!(tables.windows(2).all(|pair| pair[0] <= pair[1]));
+    Ok(())
+}
+
+#[test]
+fn test_build_to_vec() -> Result<(), Error> {
+    let records: Vec<(Vec<u8>, Vec<u8>)> = (0..500)
+        .map(|i| (format!("key{i}").into_bytes(), vec![i as u8; i % 40]))
+        .chain([(b"key1".to_vec(), b"duplicate".to_vec()), (vec![], vec![])])
+        .collect();
+
+    let mut writer = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+    for (key, value) in &records {
+        writer.put(key, value)?;
+    }
+    writer.finalize()?;
+    let expected = writer.into_inner()?.into_inner();
+
+    let built = CdbWriter::<_, CdbHash>::build_to_vec(&records)?;
+    assert!(built == expected, "build_to_vec output differs from put");
+    assert_eq!(built.capacity(), built.len());
+
+    let cdb = Cdb::<_, CdbHash>::new(built)?;
+    assert_eq!(cdb.get(b"key1")?.unwrap(), vec![1u8]);
+    assert_eq!(cdb.get(b"key499")?.unwrap(), vec![243u8; 19]);
+
+    let empty = CdbWriter::<_, CdbHash>::build_to_vec::<&[u8], &[u8]>(&[])?;
+    assert!(Cdb::<_, CdbHash>::new(empty)?.is_empty());
+    Ok(())
+}
+
+#[test]
+fn test_put_reader_and_put_vectored() -> Result<(), Error> {
+    use std::io::{Cursor, IoSlice, Seek, Write};
+
+    let big: Vec<u8> = (0..300_000u32).map(|i| (i % 251) as u8).collect();
+    let mut source = tempfile::tempfile()?;
+    source.write_all(&big)?;
+
+    for layout in [
+        cdb64::RecordLayout::PutOrder,
+        cdb64::RecordLayout::TableClustered {
+            memory_budget: 1000,
+        },
+    ] {
+        let file = NamedTempFile::new()?;
+        let mut writer = CdbWriter::<_, CdbHash>::create(file.path())?;
+        writer.set_layout(layout)?;
+        writer.set_hot_keys([(&b"hot"[..], 1)]);
+        source.rewind()?;
+        writer.put_reader(b"big", big.len() as u64, &source)?;
+        writer.put_vectored(
+            b"parts",
+            &[
+                IoSlice::new(b"one-"),
+                IoSlice::new(b""),
+                IoSlice::new(b"two-three"),
+            ],
+        )?;
+        writer.put_vectored(b"hot", &[IoSlice::new(b"hot "), IoSlice::new(b"value")])?;
+        // A reader that runs dry is rejected and leaves no trace of the record.
+        let err = writer.put_reader(b"short", 10, &b"abc"[..]).unwrap_err();
+        assert!(matches!(err, Error::Io(e) if e.kind() == std::io::ErrorKind::UnexpectedEof));
+        writer.put_reader(b"after", 1, &b"xyz"[..])?;
+        writer.finalize()?;
+
+        let mut expected = CdbWriter::<_, CdbHash>::new(Cursor::new(Vec::new()))?;
+        expected.set_layout(layout)?;
+        expected.set_hot_keys([(&b"hot"[..], 1)]);
+        for (key, value) in [
+            (&b"big"[..], &big[..]),
+            (b"parts", b"one-two-three"),
+            (b"hot", b"hot value"),
+            (b"after", b"x"),
+        ] {
+            expected.put(key, value)?;
+        }
+        expected.finalize()?;
+        let written = std::fs::read(file.path())?;
+        assert!(
+            written == expected.into_inner()?.into_inner(),
+            "{layout:?}: streamed puts differ from put"
+        );
+
+        let cdb = Cdb::<_, CdbHash>::open(file.path())?;
+        assert_eq!(cdb.get(b"big")?.unwrap(), big);
+        assert_eq!(cdb.get(b"parts")?.unwrap(), b"one-two-three");
+        assert_eq!(cdb.get(b"hot")?.unwrap(), b"hot value");
+        assert_eq!(cdb.get(b"short")?, None);
+        assert_eq!(cdb.len(), 4);
+    }
+    Ok(())
+}
+
+#[test]
+fn test_put_reader_short_last_value() -> Result<(), Error> {
+    // The partial value would reach well past the end of the finished database.
+    let partial = vec![9u8; 100_000];
+    let good: Vec<(Vec<u8>, Vec<u8>)> = (0..10)
+        .map(|i| {
+            (
+                format!("key{i}").into_bytes(),
+                format!("value{i}").into_bytes(),
+            )
+        })
+        .collect();
+    for layout in [
+        cdb64::RecordLayout::PutOrder,
+        cdb64::RecordLayout::TableClustered {
+            memory_budget: 1000,
+        },
+    ] {
+        // A file from `create` is cut back to the end of the hash tables.
+        let file = NamedTempFile::new()?;
+        let mut writer = CdbWriter::<_, CdbHash>::create(file.path())?;
+        writer.set_layout(layout)?;
+        for (key, value) in &good {
+            writer.put(key, value)?;
+        }
+        let err = writer
+            .put_reader(b"short", 200_000, &partial[..])
+            .unwrap_err();
+        assert!(matches!(err, Error::Io(e) if e.kind() == std::io::ErrorKind::UnexpectedEof));
+        writer.finalize()?;
+
+        let mut expected = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+        expected.set_layout(layout)?;
+        for (key, value) in &good {
+            expected.put(key, value)?;
+        }
+        expected.finalize()?;
+        let expected = expected.into_inner()?.into_inner();
+        let written = std::fs::read(file.path())?;
+        assert!(
+            written == expected,
+            "{layout:?}: a short value left bytes behind"
+        );
+        if layout == cdb64::RecordLayout::PutOrder {
+            assert_eq!(written, CdbWriter::<_, CdbHash>::build_to_vec(&good)?);
+        }
+
+        // Other writers keep the trailing bytes, which readers ignore.
+        let mut writer = CdbWriter::<_, CdbHash>::new(std::io::Cursor::new(Vec::new()))?;
+        writer.set_layout(layout)?;
+        for (key, value) in &good {
+            writer.put(key, value)?;
+        }
+        assert!(writer.put_reader(b"short", 200_000, &partial[..]).is_err());
+        writer.finalize()?;
+        let written = writer.into_inner()?.into_inner();
+        assert!(written.starts_with(&expected));
+        let cdb = Cdb::<_, CdbHash>::new(std::io::Cursor::new(written))?;
+        let records: Vec<(Vec<u8>, Vec<u8>)> = cdb.iter().collect::<Result<_, _>>()?;
+        assert_eq!(records.len(), good.len());
+        assert_eq!(cdb.get(b"short")?, None);
+    }
+    Ok(())
+}
@@ -0,0 +1,89 @@
+// Node harness for the cross-language binding benchmarks.
+//
+// Runs the workload described in cdb64/examples/bindings_workload.rs through the
+// binding and prints one JSON line per operation. Run with `pnpm bench` after
+// `pnpm build`.
+
+import { CdbWriter, Cdb } from '../index.js'
+import { tmpdir } from 'os'
+import { join } from 'path'
+import { unlinkSync } from 'fs'
+
+const HIT_STRIDE = 1000003
+
+const envOr = (name, fallback) => {
+  const value = Number.parseInt(process.env[name] ?? '', 10)
+  return Number.isFinite(value) ? value : fallback
+}
+
+// Runs `op` `rounds` times and returns the fastest round in nanoseconds per item.
+const bestOf = (rounds, items, op) => {
+  let best = Infinity
+  for (let round = 0; round < rounds; round++) {
+    const start = process.hrtime.bigint()
+    op()
+    best = Math.min(best, Number(process.hrtime.bigint() - start) / items)
+  }
+  return best
+}
+
+const report = (op, records, nsPerOp) => {
+  console.log(JSON.stringify({ lang: 'node', op, records, ns_per_op: Math.round(nsPerOp * 10) / 10 }))
+}
+
+const n = Math.max(envOr('CDB64_BENCH_RECORDS', 100000), 1)
+const rounds = Math.max(envOr('CDB64_BENCH_ROUNDS', 3), 1)
+const dbPath = join(tmpdir(), `cdb64-bench-node-${process.pid}.cdb`)
+
+const keys = []
+const values = []
+const hits = []
+const misses = []
+for (let i = 0; i < n; i++) {
+  keys.push(Buffer.from(`key${i}`))
+  values.push(Buffer.alloc(10 + ((i * 7919) % 191), i % 256))
+  // (j * HIT_STRIDE) stays well below 2^53 for any practical n.
+  hits.push(Buffer.from(`key${(i * HIT_STRIDE) % n}`))
+  misses.push(Buffer.from(`miss${i}`))
+}
+
+report(
+  'build',
+  n,
+  bestOf(rounds, n, () => {
+    const writer = new CdbWriter(dbPath)
+    for (let i = 0; i < n; i++) {
+      writer.put(keys[i], values[i])
+    }
+    writer.finalize()
+  }),
+)
+
+const cdb = Cdb.open(dbPath)
+report(
+  'get_hit',
+  n,
+  bestOf(rounds, n, () => {
+    for (const key of hits) {
+      if (cdb.get(key) === null) throw new Error(`missing ${key}`)
+    }
+  }),
+)
+report(
+  'get_miss',
+  n,
+  bestOf(rounds, n, () => {
+    for (const key of misses) {
+      if (cdb.get(key) !== null) throw new Error(`unexpected ${key}`)
+    }
+  }),
+)
+report(
+  'scan',
+  n,
+  bestOf(rounds, n, () => {
+    if (cdb.iter().length !== n) throw new Error('scan count mismatch')
+  }),
+)
+
+unlinkSync(dbPath)
@@ -1,10 +1,17 @@
 import test from 'ava'
 
 import { CdbWriter, Cdb } from '../index.js'
+import { writeAll, createWriteStream } from '../ingest.js'
 import { tmpdir } from 'os'
 import { join } from 'path'
 import { randomBytes } from 'crypto'
 import { unlinkSync } from 'fs'
+import { createRequire } from 'module'
+import { Readable } from 'stream'
+import { pipeline } from 'stream/promises'
+import { Worker } from 'worker_threads'
+
+const require = createRequire(import.meta.url)
 
 test('CdbWriter/Cdb native roundtrip', (t) => {
   const dbPath = join(tmpdir(), 'test-cdb-' + randomBytes(8).toString('hex') + '.cdb')
@@ -28,3 +35,86 @@ test('CdbWriter/Cdb native roundtrip', (t) => {
 
   unlinkSync(dbPath)
 })
+
+test('CdbWriter.putMany with packed buffers and finalizeAsync', async (t) => {
+  const dbPath = join(tmpdir(), 'test-cdb-' + randomBytes(8).toString('hex') + '.cdb')
+  const writer = new CdbWriter(dbPath)
+  const keys = Buffer.from('k1k22k333')
+  const values = Buffer.from('v1v22')
+  const written = writer.putMany(keys, new Uint32Array([0, 2, 5, 9]), values, new Uint32Array([0, 2, 5, 5]))
+  t.is(written, 3)
+  t.throws(() => writer.putMany(keys, new Uint32Array([0, 10]), values, new Uint32Array([0, 1])))
+  await writer.finalizeAsync()
+  t.throws(() => writer.put(Buffer.from('late'), Buffer.from('put')))
+
+  const cdb = Cdb.open(dbPath)
+  t.deepEqual(cdb.get(Buffer.from('k1')), Buffer.from('v1'))
+  t.deepEqual(cdb.get(Buffer.from('k22')), Buffer.from('v22'))
+  t.deepEqual(cdb.get(Buffer.from('k333')), Buffer.alloc(0))
+
+  unlinkSync(dbPath)
+})
+
+test('writeAll ingests an async iterable', async (t) => {
+  const dbPath = join(tmpdir(), 'test-cdb-' + randomBytes(8).toString('hex') + '.cdb')
+  async function* records() {
+    for (let i = 0; i < 1000; i++) {
+      yield [`key${i}`, Buffer.from(`value${i}`)]
+    }
+  }
+
+  const written = await writeAll(new CdbWriter(dbPath), records(), { batchRecords: 64 })
+  t.is(written, 1000)
+
+  const cdb = Cdb.open(dbPath)
+  t.deepEqual(cdb.get(Buffer.from('key0')), Buffer.from('value0'))
+  t.deepEqual(cdb.get(Buffer.from('key999')), Buffer.from('value999'))
+  t.is(cdb.iter().length, 1000)
+
+  unlinkSync(dbPath)
+})
+
+test('createWriteStream finalizes when the stream ends', async (t) => {
+  const dbPath = join(tmpdir(), 'test-cdb-' + randomBytes(8).toString('hex') + '.cdb')
+  const entries = Array.from({ length: 100 }, (_, i) => ({ key: `key${i}`, value: `value${i}` }))
+
+  await pipeline(Readable.from(entries), createWriteStream(new CdbWriter(dbPath), { batchRecords: 16 }))
+
+  const cdb = Cdb.open(dbPath)
+  t.deepEqual(cdb.get(Buffer.from('key42')), Buffer.from('value42'))
+  t.is(cdb.iter().length, 100)
+
+  unlinkSync(dbPath)
+})
+
+test('Cdb.share hands one mapping to worker_threads', async (t) => {
+  const dbPath = join(tmpdir(), 'test-cdb-' + randomBytes(8).toString('hex') + '.cdb')
+  const writer = new CdbWriter(dbPath)
+  writer.put(Buffer.from('shared'), Buffer.from('mapping'))
+  writer.finalize()
+
+  const cdb = Cdb.openMmap(dbPath)
+  const handle = cdb.share()
+  t.is(cdb.share(), handle)
+
+  const worker = new Worker(
+    `
+    const { parentPort, workerData } = require('worker_threads')
+    const { Cdb } = require(workerData.binding)
+    const cdb = Cdb.fromShared(workerData.handle)
+    parentPort.postMessage(cdb.get(Buffer.from('shared')).toString())
+    `,
+    { eval: true, workerData: { binding: require.resolve('../index.js'), handle } },
+  )
+  const [value] = await Promise.all([
+    new Promise((resolve, reject) => {
+      worker.once('message', resolve)
+      worker.once('error', reject)
+    }),
+    new Promise((resolve) => worker.once('exit', resolve)),
+  ])
+  t.is(value, 'mapping')
+  t.throws(() => Cdb.fromShared(0))
+
+  unlinkSync(dbPath)
+})
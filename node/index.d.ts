@@ -10,10 +10,40 @@ export interface CdbEntry {
 export declare class CdbWriter {
   constructor(path: string)
   put(key: Buffer, value: Buffer): void
+  /**
+   * Inserts a batch of records in a single call.
+   *
+   * `keys` and `values` hold the concatenated record bytes. Record `i` uses
+   * `keys[keyOffsets[i]..keyOffsets[i + 1]]` and
+   * `values[valueOffsets[i]..valueOffsets[i + 1]]`, so both offset arrays
+   * have one more element than there are records. Returns the number of
+   * records written.
+   */
+  putMany(keys: Buffer, keyOffsets: Uint32Array, values: Buffer, valueOffsets: Uint32Array): number
   finalize(): void
+  /**
+   * Finalizes the database on the libuv thread pool instead of the event loop.
+   *
+   * The writer cannot be used again once this has been called.
+   */
+  finalizeAsync(): Promise<void>
 }
 export declare class Cdb {
   static open(path: string): Cdb
+  /** Opens the database with a read-only memory mapping. */
+  static openMmap(path: string): Cdb
+  /**
+   * Returns a handle that `Cdb.fromShared` can attach to from any worker thread.
+   *
+   * The handle is a plain number, so it can be sent with `postMessage` or
+   * `workerData`. All attached `Cdb` objects use this instance's file
+   * descriptor and mapping. Keep this object reachable until the workers have
+   * attached; once every `Cdb` referencing the database is garbage collected,
+   * the handle becomes invalid.
+   */
+  share(): number
+  /** Attaches to a database shared by another thread with `share()`. */
+  static fromShared(handle: number): Cdb
   get(key: Buffer): Buffer | null
   iter(): Array<CdbEntry>
 }
@@ -0,0 +1,22 @@
+import type { Writable } from 'stream'
+
+import type { CdbWriter } from './index'
+
+export type CdbInput = Buffer | Uint8Array | string
+export type CdbInputEntry = [CdbInput, CdbInput] | { key: CdbInput; value: CdbInput }
+
+export interface IngestOptions {
+  /** Maximum number of records per `putMany` call. Defaults to 4096. */
+  batchRecords?: number
+  /** Flush a batch once its keys and values reach this many bytes. Defaults to 4 MiB. */
+  batchBytes?: number
+  /** Set to `false` to leave the writer open once the input ends. */
+  finalize?: boolean
+}
+
+export declare function writeAll(
+  writer: CdbWriter,
+  source: Iterable<CdbInputEntry> | AsyncIterable<CdbInputEntry>,
+  options?: IngestOptions,
+): Promise<number>
+export declare function createWriteStream(writer: CdbWriter, options?: IngestOptions): Writable
@@ -0,0 +1,112 @@
+const { Writable } = require('stream')
+
+const DEFAULT_BATCH_RECORDS = 4096
+const DEFAULT_BATCH_BYTES = 4 * 1024 * 1024
+
+function toBuffer(data) {
+  if (Buffer.isBuffer(data)) return data
+  if (data instanceof Uint8Array) return Buffer.from(data.buffer, data.byteOffset, data.byteLength)
+  if (typeof data === 'string') return Buffer.from(data)
+  throw new TypeError('cdb64: keys and values must be Buffers, Uint8Arrays or strings')
+}
+
+function toPair(entry) {
+  if (Array.isArray(entry)) return [toBuffer(entry[0]), toBuffer(entry[1])]
+  if (entry && typeof entry === 'object') return [toBuffer(entry.key), toBuffer(entry.value)]
+  throw new TypeError('cdb64: entries must be [key, value] pairs or { key, value } objects')
+}
+
+// Accumulates records and hands them to `CdbWriter.putMany` as packed buffers,
+// so crossing into native code happens once per batch instead of once per record.
+class Batch {
+  constructor(options) {
+    this.maxRecords = options.batchRecords || DEFAULT_BATCH_RECORDS
+    this.maxBytes = options.batchBytes || DEFAULT_BATCH_BYTES
+    this.reset()
+  }
+
+  reset() {
+    this.keys = []
+    this.values = []
+    this.bytes = 0
+  }
+
+  // Returns true once the batch is full and should be flushed.
+  push(key, value) {
+    this.keys.push(key)
+    this.values.push(value)
+    this.bytes += key.length + value.length
+    return this.keys.length >= this.maxRecords || this.bytes >= this.maxBytes
+  }
+
+  flush(writer) {
+    const count = this.keys.length
+    if (count === 0) return 0
+    const keyOffsets = new Uint32Array(count + 1)
+    const valueOffsets = new Uint32Array(count + 1)
+    for (let i = 0; i < count; i++) {
+      keyOffsets[i + 1] = keyOffsets[i] + this.keys[i].length
+      valueOffsets[i + 1] = valueOffsets[i] + this.values[i].length
+    }
+    writer.putMany(Buffer.concat(this.keys), keyOffsets, Buffer.concat(this.values), valueOffsets)
+    this.reset()
+    return count
+  }
+}
+
+/**
+ * Writes every entry of a (possibly async) iterable into `writer` in batches.
+ *
+ * Entries may be `[key, value]` pairs or `{ key, value }` objects. Unless
+ * `options.finalize` is `false`, the writer is finalized off the event loop
+ * once the source is exhausted. Resolves to the number of records written.
+ */
+async function writeAll(writer, source, options = {}) {
+  const batch = new Batch(options)
+  let count = 0
+  for await (const entry of source) {
+    const [key, value] = toPair(entry)
+    if (batch.push(key, value)) count += batch.flush(writer)
+  }
+  count += batch.flush(writer)
+  if (options.finalize !== false) await writer.finalizeAsync()
+  return count
+}
+
+/**
+ * Returns an object-mode `Writable` that batches entries into `writer`.
+ *
+ * Ending the stream flushes the last batch and, unless `options.finalize` is
+ * `false`, finalizes the writer on the libuv thread pool.
+ */
+function createWriteStream(writer, options = {}) {
+  const batch = new Batch(options)
+  return new Writable({
+    objectMode: true,
+    write(entry, _encoding, callback) {
+      try {
+        const [key, value] = toPair(entry)
+        if (batch.push(key, value)) batch.flush(writer)
+        callback()
+      } catch (e) {
+        callback(e)
+      }
+    },
+    final(callback) {
+      try {
+        batch.flush(writer)
+      } catch (e) {
+        callback(e)
+        return
+      }
+      if (options.finalize === false) {
+        callback()
+        return
+      }
+      writer.finalizeAsync().then(() => callback(), callback)
+    },
+  })
+}
+
+module.exports.writeAll = writeAll
+module.exports.createWriteStream = createWriteStream
@@ -1,7 +1,26 @@
 use cdb64::{CdbHash, Error as CdbError};
 use napi::bindgen_prelude::*;
+use napi::{Env, Task};
 use napi_derive::napi;
-use std::fs::File;
+use std::{
+  collections::HashMap,
+  fs::File,
+  sync::{
+    atomic::{AtomicU32, Ordering},
+    Arc, LazyLock, Mutex, Weak,
+  },
+};
+
+type SharedCdb = cdb64::Cdb<File, CdbHash>;
+
+/// Process-wide registry of databases shared with `worker_threads`.
+///
+/// The native addon is loaded once per process, so every worker sees the same
+/// registry. Entries are weak: a handle stays valid only while at least one
+/// `Cdb` object still references the database.
+static SHARED: LazyLock<Mutex<HashMap<u32, Weak<SharedCdb>>>> =
+  LazyLock::new(|| Mutex::new(HashMap::new()));
+static NEXT_SHARED_ID: AtomicU32 = AtomicU32::new(1);
 
 #[napi(object)]
 pub struct CdbEntry {
@@ -11,7 +30,8 @@ pub struct CdbEntry {
 
 #[napi]
 pub struct CdbWriter {
-  inner: cdb64::CdbWriter<File, CdbHash>,
+  // `None` once the writer has been handed to `finalizeAsync`.
+  inner: Option<cdb64::CdbWriter<File, CdbHash>>,
 }
 
 #[napi]
@@ -20,25 +40,103 @@ impl CdbWriter {
   pub fn new(path: String) -> napi::Result<Self> {
     let file = File::create(&path).map_err(|e| js_err(e.into()))?;
     let writer = cdb64::CdbWriter::<_, CdbHash>::new(file).map_err(js_err)?;
-    Ok(CdbWriter { inner: writer })
+    Ok(CdbWriter {
+      inner: Some(writer),
+    })
   }
 
   #[napi]
   pub fn put(&mut self, key: Buffer, value: Buffer) -> napi::Result<()> {
-    self.inner.put(&key, &value).map_err(js_err)?;
+    self.writer()?.put(&key, &value).map_err(js_err)?;
     Ok(())
   }
 
+  /// Inserts a batch of records in a single call.
+  ///
+  /// `keys` and `values` hold the concatenated record bytes. Record `i` uses
+  /// `keys[keyOffsets[i]..keyOffsets[i + 1]]` and
+  /// `values[valueOffsets[i]..valueOffsets[i + 1]]`, so both offset arrays
+  /// have one more element than there are records. Returns the number of
+  /// records written.
+  #[napi]
+  pub fn put_many(
+    &mut self,
+    keys: Buffer,
+    key_offsets: Uint32Array,
+    values: Buffer,
+    value_offsets: Uint32Array,
+  ) -> napi::Result<u32> {
+    if key_offsets.len() != value_offsets.len() {
+      return Err(napi::Error::from_reason(
+        "keyOffsets and valueOffsets must have the same length",
+      ));
+    }
+    if key_offsets.is_empty() {
+      return Ok(0);
+    }
+    check_offsets(&key_offsets, keys.len(), "keyOffsets")?;
+    check_offsets(&value_offsets, values.len(), "valueOffsets")?;
+
+    let writer = self.writer()?;
+    for (k, v) in key_offsets.windows(2).zip(value_offsets.windows(2)) {
+      let key = &keys[k[0] as usize..k[1] as usize];
+      let value = &values[v[0] as usize..v[1] as usize];
+      writer.put(key, value).map_err(js_err)?;
+    }
+    Ok((key_offsets.len() - 1) as u32)
+  }
+
   #[napi]
   pub fn finalize(&mut self) -> napi::Result<()> {
-    self.inner.finalize().map_err(js_err)?;
+    self.writer()?.finalize().map_err(js_err)?;
+    Ok(())
+  }
+
+  /// Finalizes the database on the libuv thread pool instead of the event loop.
+  ///
+  /// The writer cannot be used again once this has been called.
+  #[napi(ts_return_type = "Promise<void>")]
+  pub fn finalize_async(&mut self) -> napi::Result<AsyncTask<FinalizeTask>> {
+    self.writer()?;
+    Ok(AsyncTask::new(FinalizeTask {
+      writer: self.inner.take(),
+    }))
+  }
+
+  fn writer(&mut self) -> napi::Result<&mut cdb64::CdbWriter<File, CdbHash>> {
+    self
+      .inner
+      .as_mut()
+      .ok_or_else(|| js_err(CdbError::WriterFinalized))
+  }
+}
+
+pub struct FinalizeTask {
+  writer: Option<cdb64::CdbWriter<File, CdbHash>>,
+}
+
+impl Task for FinalizeTask {
+  type Output = ();
+  type JsValue = ();
+
+  fn compute(&mut self) -> napi::Result<Self::Output> {
+    match self.writer.as_mut() {
+      Some(writer) => writer.finalize().map_err(js_err),
+      None => Err(js_err(CdbError::WriterFinalized)),
+    }
+  }
+
+  fn resolve(&mut self, _env: Env, _output: Self::Output) -> napi::Result<Self::JsValue> {
+    // Close the file on the JS thread once the header has been written.
+    self.writer = None;
     Ok(())
   }
 }
 
 #[napi]
 pub struct Cdb {
-  inner: cdb64::Cdb<File, CdbHash>,
+  inner: Arc<SharedCdb>,
+  shared_id: Option<u32>,
 }
 
 #[napi]
@@ -46,7 +144,47 @@ impl Cdb {
   #[napi(factory)]
   pub fn open(path: String) -> napi::Result<Self> {
     let cdb = cdb64::Cdb::<_, CdbHash>::open(&path).map_err(|e| js_err(e.into()))?;
-    Ok(Cdb { inner: cdb })
+    Ok(Cdb::from_inner(Arc::new(cdb)))
+  }
+
+  /// Opens the database with a read-only memory mapping.
+  #[napi(factory)]
+  pub fn open_mmap(path: String) -> napi::Result<Self> {
+    let cdb = cdb64::Cdb::<_, CdbHash>::open_mmap(&path).map_err(|e| js_err(e.into()))?;
+    Ok(Cdb::from_inner(Arc::new(cdb)))
+  }
+
+  /// Returns a handle that `Cdb.fromShared` can attach to from any worker thread.
+  ///
+  /// The handle is a plain number, so it can be sent with `postMessage` or
+  /// `workerData`. All attached `Cdb` objects use this instance's file
+  /// descriptor and mapping. Keep this object reachable until the workers have
+  /// attached; once every `Cdb` referencing the database is garbage collected,
+  /// the handle becomes invalid.
+  #[napi]
+  pub fn share(&mut self) -> u32 {
+    if let Some(id) = self.shared_id {
+      return id;
+    }
+    let id = NEXT_SHARED_ID.fetch_add(1, Ordering::Relaxed);
+    let mut shared = SHARED.lock().unwrap_or_else(|e| e.into_inner());
+    shared.retain(|_, cdb| cdb.strong_count() > 0);
+    shared.insert(id, Arc::downgrade(&self.inner));
+    self.shared_id = Some(id);
+    id
+  }
+
+  /// Attaches to a database shared by another thread with `share()`.
+  #[napi(factory)]
+  pub fn from_shared(handle: u32) -> napi::Result<Self> {
+    let shared = SHARED.lock().unwrap_or_else(|e| e.into_inner());
+    let inner = shared.get(&handle).and_then(Weak::upgrade).ok_or_else(|| {
+      napi::Error::from_reason(format!("shared Cdb handle {} is no longer valid", handle))
+    })?;
+    Ok(Cdb {
+      inner,
+      shared_id: Some(handle),
+    })
   }
 
   #[napi]
@@ -69,6 +207,30 @@ impl Cdb {
   }
 }
 
+impl Cdb {
+  fn from_inner(inner: Arc<SharedCdb>) -> Self {
+    Cdb {
+      inner,
+      shared_id: None,
+    }
+  }
+}
+
+/// Checks that `offsets` is non-decreasing and stays within a buffer of `len` bytes.
+fn check_offsets(offsets: &[u32], len: usize, name: &str) -> napi::Result<()> {
+  let mut prev = 0u32;
+  for &offset in offsets {
+    if offset < prev || offset as usize > len {
+      return Err(napi::Error::from_reason(format!(
+        "{} must be non-decreasing and within the buffer (got {} after {}, buffer length {})",
+        name, offset, prev, len
+      )));
+    }
+    prev = offset;
+  }
+  Ok(())
+}
+
 fn js_err(e: CdbError) -> napi::Error {
   napi::Error::from_reason(format!("{:?}", e))
 }
@@ -1,3 +1,8 @@
-from .cdb64_python import CdbWriter, Cdb
+from collections.abc import Mapping
 
-__all__ = ["CdbWriter", "Cdb"]
+from .cdb64_python import CdbWriter, Cdb, CdbIterator, BinaryArray
+
+# `Cdb` implements the read-only mapping protocol natively.
+Mapping.register(Cdb)
+
+__all__ = ["CdbWriter", "Cdb", "CdbIterator", "BinaryArray"]
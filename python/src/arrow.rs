@@ -0,0 +1,373 @@
+//! Minimal support for the Arrow C data interface
+//! (<https://arrow.apache.org/docs/format/CDataInterface.html>) and its PyCapsule
+//! protocol, limited to the variable-size binary layouts the bindings exchange.
+
+use pyo3::{
+    exceptions::{PyTypeError, PyValueError},
+    prelude::*,
+    types::{PyBytes, PyCapsule},
+};
+use std::{
+    ffi::{CStr, CString, c_char, c_void},
+    ptr, slice,
+    sync::Arc,
+};
+
+#[repr(C)]
+pub(crate) struct ArrowSchema {
+    format: *const c_char,
+    name: *const c_char,
+    metadata: *const c_char,
+    flags: i64,
+    n_children: i64,
+    children: *mut *mut ArrowSchema,
+    dictionary: *mut ArrowSchema,
+    release: Option<unsafe extern "C" fn(*mut ArrowSchema)>,
+    private_data: *mut c_void,
+}
+
+#[repr(C)]
+pub(crate) struct ArrowArray {
+    length: i64,
+    null_count: i64,
+    offset: i64,
+    n_buffers: i64,
+    n_children: i64,
+    buffers: *mut *const c_void,
+    children: *mut *mut ArrowArray,
+    dictionary: *mut ArrowArray,
+    release: Option<unsafe extern "C" fn(*mut ArrowArray)>,
+    private_data: *mut c_void,
+}
+
+// SAFETY: the structs are plain descriptors; the memory they point to is owned by
+// the producer and only released through `release`, which may run on any thread.
+unsafe impl Send for ArrowSchema {}
+unsafe impl Send for ArrowArray {}
+
+const ARROW_FLAG_NULLABLE: i64 = 2;
+
+/// A borrowed Arrow `binary`/`large_binary` (or `utf8`/`large_utf8`) array.
+///
+/// The capsules are kept alive so that the producer's buffers stay valid for
+/// as long as this value exists.
+pub(crate) struct BinaryArrayRef<'py> {
+    _schema: Bound<'py, PyCapsule>,
+    _array: Bound<'py, PyCapsule>,
+    array: *const ArrowArray,
+    large: bool,
+}
+
+impl<'py> BinaryArrayRef<'py> {
+    /// Imports `obj` through `__arrow_c_array__`. Returns `Ok(None)` if `obj` does
+    /// not implement the Arrow PyCapsule protocol.
+    pub(crate) fn import(obj: &Bound<'py, PyAny>) -> PyResult<Option<Self>> {
+        if !obj.hasattr("__arrow_c_array__")? {
+            return Ok(None);
+        }
+        let (schema, array): (Bound<'py, PyCapsule>, Bound<'py, PyCapsule>) =
+            obj.call_method0("__arrow_c_array__")?.extract()?;
+        check_capsule_name(&schema, c"arrow_schema")?;
+        check_capsule_name(&array, c"arrow_array")?;
+
+        let schema_ptr = schema.pointer() as *const ArrowSchema;
+        let array_ptr = array.pointer() as *const ArrowArray;
+        // SAFETY: the capsule names were checked above, so the pointers refer to a live
+        // ArrowSchema and ArrowArray owned by the capsules we hold on to.
+        let (format, array_ref) = unsafe { (CStr::from_ptr((*schema_ptr).format), &*array_ptr) };
+        let large = match format.to_bytes() {
+            b"z" | b"u" => false,
+            b"Z" | b"U" => true,
+            other => {
+                return Err(PyTypeError::new_err(format!(
+                    "expected an Arrow binary or string array, got format {:?}",
+                    String::from_utf8_lossy(other)
+                )));
+            }
+        };
+        if array_ref.n_buffers != 3 || array_ref.length < 0 || array_ref.offset < 0 {
+            return Err(PyValueError::new_err("malformed Arrow binary array"));
+        }
+
+        Ok(Some(BinaryArrayRef {
+            _schema: schema,
+            _array: array,
+            array: array_ptr,
+            large,
+        }))
+    }
+
+    pub(crate) fn len(&self) -> usize {
+        // SAFETY: `array` stays valid while `_array` is alive.
+        unsafe { (*self.array).length as usize }
+    }
+
+    /// Returns the elements as slices into the producer's data buffer; nulls are `None`.
+    pub(crate) fn values(&self) -> PyResult<Vec<Option<&[u8]>>> {
+        // SAFETY: `import` checked the layout (three buffers: validity, offsets, data).
+        // Offsets are read for `offset..=offset + length`, as the format requires.
+        unsafe {
+            let array = &*self.array;
+            let len = array.length as usize;
+            let start = array.offset as usize;
+            let validity = *array.buffers as *const u8;
+            let offsets = *array.buffers.add(1);
+            let data = *array.buffers.add(2) as *const u8;
+
+            let offset_at = |i: usize| -> i64 {
+                if self.large {
+                    *(offsets as *const i64).add(start + i)
+                } else {
+                    *(offsets as *const i32).add(start + i) as i64
+                }
+            };
+
+            let mut out = Vec::with_capacity(len);
+            for i in 0..len {
+                let bit = start + i;
+                if !validity.is_null() && *validity.add(bit / 8) & (1 << (bit % 8)) == 0 {
+                    out.push(None);
+                    continue;
+                }
+                let (begin, end) = (offset_at(i), offset_at(i + 1));
+                if begin < 0 || end < begin {
+                    return Err(PyValueError::new_err("Arrow array has invalid offsets"));
+                }
+                if begin == end {
+                    out.push(Some(&[][..]));
+                } else {
+                    out.push(Some(slice::from_raw_parts(
+                        data.add(begin as usize),
+                        (end - begin) as usize,
+                    )));
+                }
+            }
+            Ok(out)
+        }
+    }
+}
+
+fn check_capsule_name(capsule: &Bound<'_, PyCapsule>, expected: &CStr) -> PyResult<()> {
+    match capsule.name()? {
+        Some(name) if name == expected => Ok(()),
+        _ => Err(PyTypeError::new_err(format!(
+            "expected a PyCapsule named {:?}",
+            expected
+        ))),
+    }
+}
+
+/// The buffers of an Arrow `large_binary` array built on the Rust side.
+pub(crate) struct BinaryBuffers {
+    pub(crate) values: Vec<u8>,
+    pub(crate) offsets: Vec<i64>,
+    pub(crate) validity: Vec<u8>,
+    pub(crate) null_count: usize,
+}
+
+impl BinaryBuffers {
+    pub(crate) fn with_capacity(len: usize) -> Self {
+        let mut offsets = Vec::with_capacity(len + 1);
+        offsets.push(0);
+        BinaryBuffers {
+            values: Vec::new(),
+            offsets,
+            validity: vec![0u8; len.div_ceil(8)],
+            null_count: 0,
+        }
+    }
+
+    pub(crate) fn push(&mut self, value: Option<&[u8]>) {
+        let i = self.offsets.len() - 1;
+        match value {
+            Some(value) => {
+                self.values.extend_from_slice(value);
+                self.validity[i / 8] |= 1 << (i % 8);
+            }
+            None => self.null_count += 1,
+        }
+        self.offsets.push(self.values.len() as i64);
+    }
+
+    pub(crate) fn len(&self) -> usize {
+        self.offsets.len() - 1
+    }
+
+    pub(crate) fn get(&self, i: usize) -> Option<&[u8]> {
+        if self.validity[i / 8] & (1 << (i % 8)) == 0 {
+            return None;
+        }
+        Some(&self.values[self.offsets[i] as usize..self.offsets[i + 1] as usize])
+    }
+}
+
+/// Result of a vectorised lookup: an Arrow `large_binary` array.
+///
+/// It can be passed to `pyarrow.array()` (or any other consumer of the Arrow
+/// PyCapsule protocol) without copying, or inspected directly through
+/// `values`, `offsets` and `validity`.
+#[pyclass(name = "BinaryArray", frozen)]
+pub(crate) struct PyBinaryArray {
+    buffers: Arc<BinaryBuffers>,
+}
+
+impl PyBinaryArray {
+    pub(crate) fn new(buffers: BinaryBuffers) -> Self {
+        PyBinaryArray {
+            buffers: Arc::new(buffers),
+        }
+    }
+}
+
+#[pymethods]
+impl PyBinaryArray {
+    fn __len__(&self) -> usize {
+        self.buffers.len()
+    }
+
+    fn __getitem__<'py>(
+        &self,
+        py: Python<'py>,
+        index: isize,
+    ) -> PyResult<Option<Bound<'py, PyBytes>>> {
+        let len = self.buffers.len() as isize;
+        let i = if index < 0 { index + len } else { index };
+        if i < 0 || i >= len {
+            return Err(pyo3::exceptions::PyIndexError::new_err(
+                "index out of range",
+            ));
+        }
+        Ok(self.buffers.get(i as usize).map(|v| PyBytes::new(py, v)))
+    }
+
+    /// Number of keys that were not found.
+    #[getter]
+    fn null_count(&self) -> usize {
+        self.buffers.null_count
+    }
+
+    /// Concatenated bytes of every found value.
+    #[getter]
+    fn values<'py>(&self, py: Python<'py>) -> Bound<'py, PyBytes> {
+        PyBytes::new(py, &self.buffers.values)
+    }
+
+    /// `len + 1` little-endian int64 offsets into `values`.
+    #[getter]
+    fn offsets<'py>(&self, py: Python<'py>) -> Bound<'py, PyBytes> {
+        let bytes: Vec<u8> = self
+            .buffers
+            .offsets
+            .iter()
+            .flat_map(|o| o.to_le_bytes())
+            .collect();
+        PyBytes::new(py, &bytes)
+    }
+
+    /// Arrow validity bitmap (LSB first); a set bit means the key was found.
+    #[getter]
+    fn validity<'py>(&self, py: Python<'py>) -> Bound<'py, PyBytes> {
+        PyBytes::new(py, &self.buffers.validity)
+    }
+
+    fn to_pylist<'py>(&self, py: Python<'py>) -> Vec<Option<Bound<'py, PyBytes>>> {
+        (0..self.buffers.len())
+            .map(|i| self.buffers.get(i).map(|v| PyBytes::new(py, v)))
+            .collect()
+    }
+
+    /// Exports the array through the Arrow PyCapsule protocol.
+    #[pyo3(signature = (requested_schema=None))]
+    fn __arrow_c_array__<'py>(
+        &self,
+        py: Python<'py>,
+        requested_schema: Option<Bound<'py, PyAny>>,
+    ) -> PyResult<(Bound<'py, PyCapsule>, Bound<'py, PyCapsule>)> {
+        // Casting to a requested schema is optional in the protocol; always export large_binary.
+        let _ = requested_schema;
+        let schema = PyCapsule::new_with_destructor(
+            py,
+            export_schema(),
+            Some(CString::from(c"arrow_schema")),
+            |mut schema: ArrowSchema, _| {
+                if let Some(release) = schema.release {
+                    unsafe { release(&mut schema) };
+                }
+            },
+        )?;
+        let array = PyCapsule::new_with_destructor(
+            py,
+            export_array(self.buffers.clone()),
+            Some(CString::from(c"arrow_array")),
+            |mut array: ArrowArray, _| {
+                if let Some(release) = array.release {
+                    unsafe { release(&mut array) };
+                }
+            },
+        )?;
+        Ok((schema, array))
+    }
+}
+
+fn export_schema() -> ArrowSchema {
+    unsafe extern "C" fn release(schema: *mut ArrowSchema) {
+        // Format and name are static strings; there is nothing else to free.
+        unsafe { (*schema).release = None };
+    }
+
+    ArrowSchema {
+        format: c"Z".as_ptr(),
+        name: c"".as_ptr(),
+        metadata: ptr::null(),
+        flags: ARROW_FLAG_NULLABLE,
+        n_children: 0,
+        children: ptr::null_mut(),
+        dictionary: ptr::null_mut(),
+        release: Some(release),
+        private_data: ptr::null_mut(),
+    }
+}
+
+/// Keeps the exported buffers, and the pointer array describing them, alive until
+/// the consumer calls `release`.
+struct ExportedArray {
+    _buffers: Arc<BinaryBuffers>,
+    pointers: [*const c_void; 3],
+}
+
+fn export_array(buffers: Arc<BinaryBuffers>) -> ArrowArray {
+    unsafe extern "C" fn release(array: *mut ArrowArray) {
+        unsafe {
+            drop(Box::from_raw((*array).private_data as *mut ExportedArray));
+            (*array).release = None;
+        }
+    }
+
+    let validity = if buffers.null_count == 0 {
+        ptr::null()
+    } else {
+        buffers.validity.as_ptr() as *const c_void
+    };
+    let mut private = Box::new(ExportedArray {
+        pointers: [
+            validity,
+            buffers.offsets.as_ptr() as *const c_void,
+            buffers.values.as_ptr() as *const c_void,
+        ],
+        _buffers: buffers.clone(),
+    });
+    let pointers = private.pointers.as_mut_ptr();
+
+    ArrowArray {
+        length: buffers.len() as i64,
+        null_count: buffers.null_count as i64,
+        offset: 0,
+        n_buffers: 3,
+        n_children: 0,
+        buffers: pointers,
+        children: ptr::null_mut(),
+        dictionary: ptr::null_mut(),
+        release: Some(release),
+        private_data: Box::into_raw(private) as *mut c_void,
+    }
+}
@@ -1,10 +1,14 @@
+mod arrow;
+mod pool;
+
+use arrow::{BinaryArrayRef, BinaryBuffers, PyBinaryArray};
 use cdb64::{CdbHash, Error as CdbError};
 use pyo3::{
-    exceptions::PyIOError,
+    exceptions::{PyIOError, PyKeyError, PyTypeError, PyValueError},
     prelude::*,
-    types::{PyBytes, PyList},
+    types::{PyBytes, PyDict, PyMemoryView, PySlice, PyType},
 };
-use std::fs::File;
+use std::{collections::VecDeque, fs::File, io};
 
 #[pyclass(name = "CdbWriter")]
 struct PyCdbWriter {
@@ -25,49 +29,517 @@ impl PyCdbWriter {
         Ok(())
     }
 
-    fn finalize(&mut self) -> PyResult<()> {
-        self.inner.finalize().map_err(map_cdb_err)?;
+    /// Writes every `(key, value)` pair of `records`, an iterable of `bytes` tuples.
+    ///
+    /// Records are gathered in batches and written with the GIL released.
+    /// Returns the number of records written.
+    fn put_many(&mut self, py: Python<'_>, records: &Bound<'_, PyAny>) -> PyResult<usize> {
+        let mut written = 0;
+        let mut batch: Vec<(Bound<'_, PyBytes>, Bound<'_, PyBytes>)> =
+            Vec::with_capacity(PUT_BATCH_RECORDS);
+        let mut records = records.try_iter()?;
+        loop {
+            batch.clear();
+            for record in records.by_ref().take(PUT_BATCH_RECORDS) {
+                batch.push(record?.extract()?);
+            }
+            if batch.is_empty() {
+                return Ok(written);
+            }
+
+            let pairs: Vec<(&[u8], &[u8])> = batch
+                .iter()
+                .map(|(k, v)| (k.as_bytes(), v.as_bytes()))
+                .collect();
+            let inner = &mut self.inner;
+            py.allow_threads(|| pairs.iter().try_for_each(|(k, v)| inner.put(k, v)))
+                .map_err(map_cdb_err)?;
+            written += pairs.len();
+        }
+    }
+
+    /// Writes one record per element of two Arrow binary or string arrays of equal length.
+    ///
+    /// Both arrays (anything implementing `__arrow_c_array__`, such as `pyarrow.Array`)
+    /// are read in place, and the records are written with the GIL released. Null keys
+    /// or values are rejected. Returns the number of records written.
+    fn put_arrow<'py>(
+        &mut self,
+        py: Python<'py>,
+        keys: &Bound<'py, PyAny>,
+        values: &Bound<'py, PyAny>,
+    ) -> PyResult<usize> {
+        let (keys, values) = (import_array(keys)?, import_array(values)?);
+        if keys.len() != values.len() {
+            return Err(PyValueError::new_err(format!(
+                "keys and values must have the same length ({} != {})",
+                keys.len(),
+                values.len()
+            )));
+        }
+        let pairs = keys
+            .values()?
+            .into_iter()
+            .zip(values.values()?)
+            .map(|pair| match pair {
+                (Some(k), Some(v)) => Ok((k, v)),
+                _ => Err(PyValueError::new_err(
+                    "put_arrow does not accept null keys or values",
+                )),
+            })
+            .collect::<PyResult<Vec<_>>>()?;
+
+        let inner = &mut self.inner;
+        py.allow_threads(|| pairs.iter().try_for_each(|(k, v)| inner.put(k, v)))
+            .map_err(map_cdb_err)?;
+        Ok(pairs.len())
+    }
+
+    /// Builds the hash tables and header with the GIL released.
+    fn finalize(&mut self, py: Python<'_>) -> PyResult<()> {
+        let inner = &mut self.inner;
+        py.allow_threads(|| inner.finalize()).map_err(map_cdb_err)?;
         Ok(())
     }
+
+    fn __enter__(slf: PyRef<'_, Self>) -> PyRef<'_, Self> {
+        slf
+    }
+
+    /// Finalizes the database when the `with` block completes normally.
+    ///
+    /// If the block raised, the file is left unfinalized rather than being
+    /// published with only part of the records.
+    #[pyo3(signature = (exc_type, _exc_value=None, _traceback=None))]
+    fn __exit__(
+        &mut self,
+        py: Python<'_>,
+        exc_type: Option<Bound<'_, PyAny>>,
+        _exc_value: Option<Bound<'_, PyAny>>,
+        _traceback: Option<Bound<'_, PyAny>>,
+    ) -> PyResult<bool> {
+        if exc_type.is_none() {
+            self.finalize(py)?;
+        }
+        Ok(false)
+    }
 }
 
-#[pyclass(name = "Cdb")]
+/// Records handed to the writer per GIL release by `CdbWriter.put_many`.
+const PUT_BATCH_RECORDS: usize = 1024;
+
+#[pyclass(name = "Cdb", module = "cdb64_python", frozen)]
 struct PyCdb {
     inner: cdb64::Cdb<File, CdbHash>,
+    // Kept so that pickling can reopen the same file in another process.
+    path: String,
+    // Python `mmap.mmap` over the same file, set by `open_mmap`. Views returned by
+    // `get_view` slice this object, so the mapping lives as long as any view does.
+    mapping: Option<Py<PyAny>>,
 }
 
 #[pymethods]
 impl PyCdb {
+    /// Opens the database at `path`; the same as `open`, or `open_mmap` if `mmap` is true.
+    #[new]
+    #[pyo3(signature = (path, mmap=false))]
+    fn new(py: Python<'_>, path: String, mmap: bool) -> PyResult<Self> {
+        if mmap {
+            Self::open_mmap(py, path)
+        } else {
+            Self::open(path)
+        }
+    }
+
     #[staticmethod]
     fn open(path: String) -> PyResult<Self> {
         let cdb =
             cdb64::Cdb::<_, CdbHash>::open(&path).map_err(|e| PyIOError::new_err(e.to_string()))?;
-        Ok(PyCdb { inner: cdb })
+        Ok(PyCdb {
+            inner: cdb,
+            path,
+            mapping: None,
+        })
+    }
+
+    /// Opens the database with a read-only memory mapping.
+    ///
+    /// Lookups read straight from the mapping, and `get_view` can return values
+    /// without copying them.
+    #[staticmethod]
+    fn open_mmap(py: Python<'_>, path: String) -> PyResult<Self> {
+        let cdb = cdb64::Cdb::<_, CdbHash>::open_mmap(&path)
+            .map_err(|e| PyIOError::new_err(e.to_string()))?;
+        Ok(PyCdb {
+            mapping: Some(map_file(py, cdb.get_ref())?),
+            inner: cdb,
+            path,
+        })
+    }
+
+    /// The path the database was opened from.
+    #[getter]
+    fn path(&self) -> &str {
+        &self.path
+    }
+
+    /// Pickles as the path and open mode, so the handle is reopened in the receiving
+    /// process rather than copied. Reopening only reads the 4 KiB header; the data is
+    /// served from the shared page cache.
+    fn __reduce__<'py>(slf: &Bound<'py, Self>) -> (Bound<'py, PyType>, (String, bool)) {
+        let cdb = slf.get();
+        (slf.get_type(), (cdb.path.clone(), cdb.mapping.is_some()))
+    }
+
+    /// Looks up `key`, releasing the GIL while the hash tables and record are read.
+    ///
+    /// Returns `default` if the key is not present.
+    #[pyo3(signature = (key, default=None))]
+    fn get<'py>(
+        &self,
+        py: Python<'py>,
+        key: &[u8],
+        default: Option<Bound<'py, PyAny>>,
+    ) -> PyResult<Option<Bound<'py, PyAny>>> {
+        match self.lookup(py, key)? {
+            Some(value) => Ok(Some(value.into_any())),
+            None => Ok(default),
+        }
+    }
+
+    fn __getitem__<'py>(&self, py: Python<'py>, key: &[u8]) -> PyResult<Bound<'py, PyBytes>> {
+        self.lookup(py, key)?
+            .ok_or_else(|| PyKeyError::new_err(PyBytes::new(py, key).unbind()))
+    }
+
+    /// Checks for `key` without reading its value.
+    fn __contains__(&self, py: Python<'_>, key: &[u8]) -> PyResult<bool> {
+        let inner = &self.inner;
+        match py.allow_threads(|| inner.locate(key)) {
+            Ok(location) => Ok(location.is_some()),
+            Err(e) => Err(map_cdb_err(e.into())),
+        }
+    }
+
+    fn __len__(&self) -> usize {
+        self.inner.len() as usize
+    }
+
+    /// Iterates over the keys, like a `dict`.
+    fn __iter__(slf: &Bound<'_, Self>) -> PyCdbIterator {
+        PyCdbIterator::new(slf, IterKind::Keys)
+    }
+
+    /// Returns a lazy iterator over the keys.
+    fn keys(slf: &Bound<'_, Self>) -> PyCdbIterator {
+        PyCdbIterator::new(slf, IterKind::Keys)
+    }
+
+    /// Returns a lazy iterator over the values.
+    fn values(slf: &Bound<'_, Self>) -> PyCdbIterator {
+        PyCdbIterator::new(slf, IterKind::Values)
+    }
+
+    /// Returns a lazy iterator over `(key, value)` pairs.
+    fn items(slf: &Bound<'_, Self>) -> PyCdbIterator {
+        PyCdbIterator::new(slf, IterKind::Items)
+    }
+
+    /// Looks up `key` and returns a read-only `memoryview` of the value inside the mapping.
+    ///
+    /// No bytes are copied. The view keeps the mapping alive, even after this `Cdb`
+    /// is dropped, so it can be handed to numpy or pyarrow directly. Only available
+    /// on databases opened with `open_mmap`.
+    fn get_view<'py>(
+        &self,
+        py: Python<'py>,
+        key: &[u8],
+    ) -> PyResult<Option<Bound<'py, PyMemoryView>>> {
+        let mapping = self.mapping.as_ref().ok_or_else(|| {
+            PyValueError::new_err("get_view requires a database opened with Cdb.open_mmap")
+        })?;
+        let inner = &self.inner;
+        let location = match py.allow_threads(|| inner.locate(key)) {
+            Ok(Some(location)) => location,
+            Ok(None) => return Ok(None),
+            Err(e) => return Err(map_cdb_err(e.into())),
+        };
+
+        // Slicing would silently clamp a record that runs past the mapping, so check the
+        // bounds here and fail the way `get` does on a truncated file.
+        let mapping = mapping.bind(py);
+        let mapped = mapping.len()? as u64;
+        let end = location
+            .offset
+            .checked_add(location.len)
+            .filter(|&end| end <= mapped)
+            .ok_or_else(|| {
+                map_cdb_err(
+                    std::io::Error::new(
+                        std::io::ErrorKind::UnexpectedEof,
+                        "value extends beyond the end of the file",
+                    )
+                    .into(),
+                )
+            })?;
+        let view = PyMemoryView::from(mapping)?;
+        // Both bounds lie within the mapping, so they fit an `isize`.
+        let slice = view.get_item(PySlice::new(py, location.offset as isize, end as isize, 1))?;
+        Ok(Some(slice.downcast_into::<PyMemoryView>()?))
+    }
+
+    /// Looks up many keys in one call and returns an Arrow `large_binary` array.
+    ///
+    /// `keys` is either an Arrow binary/string array (anything implementing
+    /// `__arrow_c_array__`, such as a `pyarrow.Array`) whose buffers are read in
+    /// place, or any iterable of `bytes` and `None`. All lookups run in Rust with the
+    /// GIL released. Element `i` of the result holds the value for `keys[i]`, or null
+    /// when the key is missing or null.
+    fn get_many(&self, py: Python<'_>, keys: &Bound<'_, PyAny>) -> PyResult<PyBinaryArray> {
+        let arrow = BinaryArrayRef::import(keys)?;
+        let owned: Vec<Option<Bound<'_, PyBytes>>>;
+        let key_slices = match &arrow {
+            Some(array) => array.values()?,
+            None => {
+                owned = extract_keys(keys)?;
+                owned
+                    .iter()
+                    .map(|k| k.as_ref().map(|k| k.as_bytes()))
+                    .collect()
+            }
+        };
+
+        let inner = &self.inner;
+        let buffers = py
+            .allow_threads(|| lookup_many(inner, &key_slices))
+            .map_err(|e| map_cdb_err(e.into()))?;
+        Ok(PyBinaryArray::new(buffers))
+    }
+
+    /// Looks up `key` on a native thread pool and returns an awaitable.
+    ///
+    /// The same as `get`, but the event loop keeps running while the file is read:
+    /// `value = await cdb.aget(key)`. Must be called from a running event loop.
+    fn aget<'py>(slf: &Bound<'py, Self>, key: &[u8]) -> PyResult<Bound<'py, PyAny>> {
+        let cdb = slf.clone().unbind();
+        let key = key.to_vec();
+        pool::spawn_future(
+            slf.py(),
+            move || cdb.get().inner.get(&key).map_err(|e| map_cdb_err(e.into())),
+            |py, value: Option<Vec<u8>>| {
+                Ok(match value {
+                    Some(value) => PyBytes::new(py, &value).into_any().unbind(),
+                    None => py.None(),
+                })
+            },
+        )
+    }
+
+    /// Looks up many keys on a native thread pool and returns an awaitable.
+    ///
+    /// Accepts the same `keys` as `get_many` and resolves to the same Arrow array.
+    /// The keys are copied before this returns, so the caller may reuse its buffers.
+    fn aget_many<'py>(
+        slf: &Bound<'py, Self>,
+        keys: &Bound<'py, PyAny>,
+    ) -> PyResult<Bound<'py, PyAny>> {
+        let owned: Vec<Option<Vec<u8>>> = match BinaryArrayRef::import(keys)? {
+            Some(array) => array
+                .values()?
+                .into_iter()
+                .map(|key| key.map(<[u8]>::to_vec))
+                .collect(),
+            None => extract_keys(keys)?
+                .iter()
+                .map(|key| key.as_ref().map(|key| key.as_bytes().to_vec()))
+                .collect(),
+        };
+        let cdb = slf.clone().unbind();
+        pool::spawn_future(
+            slf.py(),
+            move || {
+                let key_slices: Vec<Option<&[u8]>> = owned.iter().map(Option::as_deref).collect();
+                lookup_many(&cdb.get().inner, &key_slices).map_err(|e| map_cdb_err(e.into()))
+            },
+            |py, buffers| Ok(Py::new(py, PyBinaryArray::new(buffers))?.into_any()),
+        )
     }
 
-    fn get<'py>(&self, py: Python<'py>, key: &[u8]) -> PyResult<Option<Bound<'py, PyBytes>>> {
-        match self.inner.get(key) {
+    /// Returns a lazy iterator over `(key, value)` pairs; the same as `items()`.
+    fn iter(slf: &Bound<'_, Self>) -> PyCdbIterator {
+        PyCdbIterator::new(slf, IterKind::Items)
+    }
+}
+
+impl PyCdb {
+    fn lookup<'py>(&self, py: Python<'py>, key: &[u8]) -> PyResult<Option<Bound<'py, PyBytes>>> {
+        let inner = &self.inner;
+        match py.allow_threads(|| inner.get(key)) {
             Ok(Some(value)) => Ok(Some(PyBytes::new(py, &value))),
             Ok(None) => Ok(None),
             Err(e) => Err(map_cdb_err(e.into())),
         }
     }
+}
+
+/// Records read per GIL release while iterating, bounded again by `ITER_BATCH_BYTES`.
+const ITER_BATCH_RECORDS: usize = 256;
+const ITER_BATCH_BYTES: usize = 1 << 20;
+
+#[derive(Clone, Copy)]
+enum IterKind {
+    Keys,
+    Values,
+    Items,
+}
+
+/// A lazy cursor over the records of a `Cdb`.
+///
+/// Records are read in small batches with the GIL released, so memory use stays
+/// bounded no matter how large the file is.
+#[pyclass(name = "CdbIterator")]
+struct PyCdbIterator {
+    cdb: Py<PyCdb>,
+    kind: IterKind,
+    position: u64,
+    buffer: VecDeque<(Vec<u8>, Vec<u8>)>,
+    error: Option<io::Error>,
+    exhausted: bool,
+}
+
+impl PyCdbIterator {
+    fn new(cdb: &Bound<'_, PyCdb>, kind: IterKind) -> Self {
+        PyCdbIterator {
+            cdb: cdb.clone().unbind(),
+            kind,
+            position: 0,
+            buffer: VecDeque::new(),
+            error: None,
+            exhausted: false,
+        }
+    }
 
-    fn iter<'py>(&self, py: Python<'py>) -> PyResult<Bound<'py, PyList>> {
-        let mut list = Vec::new();
-        for entry in self.inner.iter() {
-            match entry {
-                Ok((k, v)) => {
-                    let py_key = PyBytes::new(py, &k);
-                    let py_value = PyBytes::new(py, &v);
-                    list.push((py_key, py_value));
+    fn refill(&mut self, py: Python<'_>) {
+        let inner = &self.cdb.get().inner;
+        let position = self.position;
+        let (batch, position, error, exhausted) = py.allow_threads(|| {
+            let mut iter = inner.iter_from(position);
+            let mut batch = VecDeque::new();
+            let mut bytes = 0;
+            while batch.len() < ITER_BATCH_RECORDS && bytes < ITER_BATCH_BYTES {
+                match iter.next() {
+                    Some(Ok((k, v))) => {
+                        bytes += k.len() + v.len();
+                        batch.push_back((k, v));
+                    }
+                    Some(Err(e)) => return (batch, iter.position(), Some(e), true),
+                    None => return (batch, iter.position(), None, true),
                 }
-                Err(e) => return Err(map_cdb_err(e.into())),
             }
+            (batch, iter.position(), None, false)
+        });
+        self.buffer = batch;
+        self.position = position;
+        self.error = error;
+        self.exhausted = exhausted;
+    }
+}
+
+#[pymethods]
+impl PyCdbIterator {
+    fn __iter__(slf: PyRef<'_, Self>) -> PyRef<'_, Self> {
+        slf
+    }
+
+    fn __next__<'py>(&mut self, py: Python<'py>) -> PyResult<Option<Bound<'py, PyAny>>> {
+        if self.buffer.is_empty() && !self.exhausted {
+            self.refill(py);
         }
+        let Some((k, v)) = self.buffer.pop_front() else {
+            return match self.error.take() {
+                Some(e) => Err(map_cdb_err(e.into())),
+                None => Ok(None),
+            };
+        };
+        let item = match self.kind {
+            IterKind::Keys => PyBytes::new(py, &k).into_any(),
+            IterKind::Values => PyBytes::new(py, &v).into_any(),
+            IterKind::Items => (PyBytes::new(py, &k), PyBytes::new(py, &v))
+                .into_pyobject(py)?
+                .into_any(),
+        };
+        Ok(Some(item))
+    }
+}
 
-        PyList::new(py, &list)
+/// Reads the value of every key into one set of Arrow buffers; null keys yield nulls.
+fn lookup_many(
+    inner: &cdb64::Cdb<File, CdbHash>,
+    keys: &[Option<&[u8]>],
+) -> io::Result<BinaryBuffers> {
+    let mut buffers = BinaryBuffers::with_capacity(keys.len());
+    for key in keys {
+        match key {
+            Some(key) => buffers.push(inner.get(key)?.as_deref()),
+            None => buffers.push(None),
+        }
     }
+    Ok(buffers)
+}
+
+/// Imports an Arrow binary array, failing if `array` does not implement `__arrow_c_array__`.
+fn import_array<'py>(array: &Bound<'py, PyAny>) -> PyResult<BinaryArrayRef<'py>> {
+    BinaryArrayRef::import(array)?
+        .ok_or_else(|| PyTypeError::new_err("expected an array implementing __arrow_c_array__"))
+}
+
+/// Collects an iterable of `bytes` (or `None`) without copying the key bytes.
+fn extract_keys<'py>(keys: &Bound<'py, PyAny>) -> PyResult<Vec<Option<Bound<'py, PyBytes>>>> {
+    keys.try_iter()?
+        .map(|key| {
+            let key = key?;
+            if key.is_none() {
+                return Ok(None);
+            }
+            Ok(Some(key.downcast_into::<PyBytes>()?))
+        })
+        .collect()
+}
+
+/// Maps `file` read-only with Python's `mmap` module.
+///
+/// The mapping is built from a duplicate of the descriptor the Rust handle reads
+/// through, not by opening the path again. If the path was replaced after the Rust
+/// handle opened it, both still see the same file, so offsets from `locate` always
+/// slice the file they came from.
+fn map_file<'py>(py: Python<'py>, file: &File) -> PyResult<Py<PyAny>> {
+    let mmap = py.import("mmap")?;
+    let dup = file
+        .try_clone()
+        .map_err(|e| PyIOError::new_err(e.to_string()))?;
+    let kwargs = PyDict::new(py);
+    kwargs.set_item("access", mmap.getattr("ACCESS_READ")?)?;
+    let map = |fd: Bound<'py, PyAny>| mmap.getattr("mmap")?.call((fd, 0), Some(&kwargs));
+
+    // `mmap.mmap` keeps its own duplicate of the descriptor, so ours is closed after.
+    #[cfg(unix)]
+    let mapping = {
+        use std::os::fd::AsRawFd;
+        map(dup.as_raw_fd().into_pyobject(py)?.into_any())
+    };
+    #[cfg(windows)]
+    let mapping = {
+        use std::os::windows::io::IntoRawHandle;
+        // Python's mmap takes a C runtime descriptor; this one owns the handle.
+        let handle = dup.into_raw_handle() as isize;
+        let fd = py
+            .import("msvcrt")?
+            .call_method1("open_osfhandle", (handle, 0))?;
+        let mapping = map(fd.clone());
+        py.import("os")?.call_method1("close", (fd,))?;
+        mapping
+    };
+    Ok(mapping?.unbind())
 }
 
 fn map_cdb_err(e: CdbError) -> PyErr {
@@ -78,5 +550,7 @@ fn map_cdb_err(e: CdbError) -> PyErr {
 fn cdb64_python(_py: Python<'_>, m: &Bound<'_, PyModule>) -> PyResult<()> {
     m.add_class::<PyCdbWriter>()?;
     m.add_class::<PyCdb>()?;
+    m.add_class::<PyCdbIterator>()?;
+    m.add_class::<PyBinaryArray>()?;
     Ok(())
 }
@@ -0,0 +1,132 @@
+//! A small native thread pool that resolves asyncio futures.
+//!
+//! `Cdb.aget` and `Cdb.aget_many` hand their lookups to these threads instead of
+//! going through `loop.run_in_executor`, so awaiting a lookup costs one future and
+//! one `call_soon_threadsafe` callback, with the GIL released while the file is read.
+
+use pyo3::{exceptions::PyRuntimeError, prelude::*, sync::GILOnceCell, types::PyCFunction};
+use std::{
+    io,
+    panic::{self, AssertUnwindSafe},
+    sync::{
+        Arc, Mutex,
+        mpsc::{self, Receiver, Sender},
+    },
+    thread,
+};
+
+type Job = Box<dyn FnOnce() + Send>;
+
+/// Upper bound on worker threads; lookups are short, so more rarely helps.
+const MAX_THREADS: usize = 16;
+
+struct Pool {
+    // Worker threads do not survive `fork`, so a child process starts its own pool.
+    pid: u32,
+    jobs: Sender<Job>,
+}
+
+static POOL: Mutex<Option<Pool>> = Mutex::new(None);
+
+fn submit(job: Job) -> io::Result<()> {
+    let mut pool = POOL.lock().unwrap_or_else(|e| e.into_inner());
+    let pid = std::process::id();
+    if pool.as_ref().is_none_or(|pool| pool.pid != pid) {
+        *pool = Some(Pool {
+            pid,
+            jobs: start_workers()?,
+        });
+    }
+    pool.as_ref()
+        .expect("pool was just started")
+        .jobs
+        .send(job)
+        .map_err(|_| io::Error::other("lookup thread pool has shut down"))
+}
+
+fn start_workers() -> io::Result<Sender<Job>> {
+    let threads = thread::available_parallelism()
+        .map_or(4, |n| n.get())
+        .min(MAX_THREADS);
+    let (sender, receiver) = mpsc::channel::<Job>();
+    let receiver = Arc::new(Mutex::new(receiver));
+    for i in 0..threads {
+        let receiver = Arc::clone(&receiver);
+        thread::Builder::new()
+            .name(format!("cdb64-lookup-{i}"))
+            .spawn(move || run_worker(&receiver))?;
+    }
+    Ok(sender)
+}
+
+fn run_worker(receiver: &Mutex<Receiver<Job>>) {
+    loop {
+        let job = receiver.lock().unwrap_or_else(|e| e.into_inner()).recv();
+        match job {
+            Ok(job) => job(),
+            Err(_) => return,
+        }
+    }
+}
+
+/// Runs `work` on the pool and returns an asyncio future for its result.
+///
+/// The future belongs to the running event loop and is resolved on that loop
+/// through `call_soon_threadsafe`. `convert` turns the result into a Python object
+/// once the GIL is held again. If the future was cancelled in the meantime, the
+/// result is dropped.
+pub(crate) fn spawn_future<'py, T, W>(
+    py: Python<'py>,
+    work: W,
+    convert: fn(Python<'_>, T) -> PyResult<Py<PyAny>>,
+) -> PyResult<Bound<'py, PyAny>>
+where
+    T: Send + 'static,
+    W: FnOnce() -> PyResult<T> + Send + 'static,
+{
+    let event_loop = py.import("asyncio")?.call_method0("get_running_loop")?;
+    let future = event_loop.call_method0("create_future")?;
+    let resolve = resolver(py)?.clone_ref(py);
+    let (event_loop_ref, future_ref) = (event_loop.unbind(), future.clone().unbind());
+
+    submit(Box::new(move || {
+        let outcome = panic::catch_unwind(AssertUnwindSafe(work))
+            .unwrap_or_else(|_| Err(PyRuntimeError::new_err("lookup panicked")));
+        Python::with_gil(|py| {
+            let event_loop = event_loop_ref.into_bound(py);
+            let (result, failed) = match outcome.and_then(|value| convert(py, value)) {
+                Ok(value) => (value, false),
+                Err(e) => (e.into_value(py).into_any(), true),
+            };
+            // This only fails once the loop is closed, and then nobody is waiting.
+            let _ = event_loop.call_method1(
+                "call_soon_threadsafe",
+                (resolve, future_ref, result, failed),
+            );
+        });
+    }))?;
+    Ok(future)
+}
+
+fn resolver(py: Python<'_>) -> PyResult<&Py<PyCFunction>> {
+    static RESOLVER: GILOnceCell<Py<PyCFunction>> = GILOnceCell::new();
+    RESOLVER.get_or_try_init(py, || Ok(wrap_pyfunction!(resolve_future, py)?.unbind()))
+}
+
+/// Completes `future` on its event loop, unless it was cancelled while the lookup ran.
+#[pyfunction]
+fn resolve_future(
+    future: &Bound<'_, PyAny>,
+    result: &Bound<'_, PyAny>,
+    failed: bool,
+) -> PyResult<()> {
+    if future.call_method0("done")?.is_truthy()? {
+        return Ok(());
+    }
+    if failed {
+        future.call_method1("set_exception", (result,))?;
+    } else {
+        future.call_method1("set_result", (result,))?;
+    }
+    Ok(())
+}
@@ -0,0 +1,97 @@
+"""Python harness for the cross-language binding benchmarks.
+
+Runs the workload described in cdb64/examples/bindings_workload.rs through the
+binding and prints one JSON line per operation. The get_hit_tN lines repeat the
+hit lookups across N threads and show how throughput scales with the GIL released
+around each probe; bench/compare.py ignores them. Not collected by pytest; run it
+directly with `python tests/bench_bindings.py` after `maturin develop --release`.
+"""
+
+import json
+import math
+import os
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+from cdb64_python import Cdb, CdbWriter
+
+HIT_STRIDE = 1000003
+THREAD_COUNTS = (2, 4, 8)
+
+
+def env_or(name, default):
+    try:
+        return int(os.environ.get(name, ""))
+    except ValueError:
+        return default
+
+
+def best_of(rounds, items, op):
+    """Runs `op` `rounds` times and returns the fastest round in nanoseconds per item."""
+    best = math.inf
+    for _ in range(rounds):
+        start = time.perf_counter_ns()
+        op()
+        best = min(best, (time.perf_counter_ns() - start) / items)
+    return best
+
+
+def check_threaded(pool, cdb, chunks):
+    """Looks up each chunk of keys on its own pool thread and checks every key was found."""
+    missing = sum(pool.map(lambda chunk: sum(cdb.get(key) is None for key in chunk), chunks))
+    if missing:
+        raise AssertionError("%d keys missing from threaded lookups" % missing)
+
+
+def report(op, records, ns_per_op):
+    print(json.dumps({"lang": "python", "op": op, "records": records, "ns_per_op": round(ns_per_op, 1)}))
+
+
+def main():
+    n = max(env_or("CDB64_BENCH_RECORDS", 100000), 1)
+    rounds = max(env_or("CDB64_BENCH_ROUNDS", 3), 1)
+    path = os.path.join(tempfile.gettempdir(), "cdb64-bench-python-%d.cdb" % os.getpid())
+
+    keys = [b"key%d" % i for i in range(n)]
+    values = [bytes([i % 256]) * (10 + (i * 7919) % 191) for i in range(n)]
+    hits = [b"key%d" % ((j * HIT_STRIDE) % n) for j in range(n)]
+    misses = [b"miss%d" % j for j in range(n)]
+
+    def build():
+        writer = CdbWriter(path)
+        for key, value in zip(keys, values):
+            writer.put(key, value)
+        writer.finalize()
+
+    report("build", n, best_of(rounds, n, build))
+
+    cdb = Cdb.open(path)
+
+    def get_hit():
+        for key in hits:
+            if cdb.get(key) is None:
+                raise AssertionError("missing %r" % key)
+
+    def get_miss():
+        for key in misses:
+            if cdb.get(key) is not None:
+                raise AssertionError("unexpected %r" % key)
+
+    def scan():
+        if sum(1 for _ in cdb.items()) != n:
+            raise AssertionError("scan count mismatch")
+
+    report("get_hit", n, best_of(rounds, n, get_hit))
+    for num_threads in THREAD_COUNTS:
+        chunks = [hits[t::num_threads] for t in range(num_threads)]
+        with ThreadPoolExecutor(max_workers=num_threads) as pool:
+            ns = best_of(rounds, n, lambda: check_threaded(pool, cdb, chunks))
+        report("get_hit_t%d" % num_threads, n, ns)
+    report("get_miss", n, best_of(rounds, n, get_miss))
+    report("scan", n, best_of(rounds, n, scan))
+    os.remove(path)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,6 @@
 import pytest
 import os
+import struct
 from cdb64_python import CdbWriter, Cdb
 
 @pytest.fixture
@@ -67,3 +68,210 @@ def test_iter_empty_cdb():
     items = list(cdb.iter())
     assert items == []
     os.remove(file_path)
+
+def test_open_mmap_get(cdb_file):
+    cdb = Cdb.open_mmap(cdb_file)
+    assert cdb.get(b"key1") == b"value1"
+    assert cdb.get(b"nonexistentkey") is None
+
+def test_get_view_is_zero_copy_memoryview(cdb_file):
+    cdb = Cdb.open_mmap(cdb_file)
+    view = cdb.get_view(b"anotherkey")
+    assert isinstance(view, memoryview)
+    assert view.readonly
+    assert view.tobytes() == b"anothervalue"
+    assert cdb.get_view(b"nonexistentkey") is None
+
+    # The view keeps the mapping alive after the database object is gone
+    del cdb
+    assert bytes(view) == b"anothervalue"
+    view.release()
+
+@pytest.mark.parametrize("value_len", [1 << 20, 2**63, 2**64 - 1])
+def test_get_view_rejects_value_past_end(cdb_file, tmp_path, value_len):
+    # key1 is the first record; point its value length past the end of the file.
+    with open(cdb_file, "rb") as f:
+        data = bytearray(f.read())
+    struct.pack_into("<Q", data, 4096 + 8, value_len)
+    corrupt = tmp_path / "corrupt.cdb"
+    corrupt.write_bytes(data)
+
+    cdb = Cdb.open_mmap(str(corrupt))
+    with pytest.raises(OSError):
+        cdb.get_view(b"key1")
+    assert bytes(cdb.get_view(b"key2")) == b"value2"
+
+def test_get_view_requires_mmap(cdb_file):
+    cdb = Cdb.open(cdb_file)
+    with pytest.raises(ValueError):
+        cdb.get_view(b"key1")
+
+def test_mapping_protocol(cdb_file):
+    cdb = Cdb.open(cdb_file)
+    assert len(cdb) == 3
+    assert b"key1" in cdb
+    assert b"nonexistentkey" not in cdb
+    assert cdb[b"key2"] == b"value2"
+    with pytest.raises(KeyError):
+        cdb[b"nonexistentkey"]
+    assert cdb.get(b"nonexistentkey", b"fallback") == b"fallback"
+
+    assert set(cdb) == {b"key1", b"key2", b"anotherkey"}
+    assert set(cdb.keys()) == {b"key1", b"key2", b"anotherkey"}
+    assert set(cdb.values()) == {b"value1", b"value2", b"anothervalue"}
+    assert dict(cdb.items()) == {b"key1": b"value1", b"key2": b"value2", b"anotherkey": b"anothervalue"}
+
+    from collections.abc import Mapping
+    assert isinstance(cdb, Mapping)
+
+def test_iteration_is_lazy():
+    file_path = "lazy_iter.cdb"
+    writer = CdbWriter(file_path)
+    for i in range(1000):
+        writer.put(b"key%d" % i, b"value%d" % i)
+    writer.finalize()
+
+    cdb = Cdb.open(file_path)
+    items = cdb.items()
+    assert not isinstance(items, list)
+    assert next(items) == (b"key0", b"value0")
+    assert sum(1 for _ in items) == 999
+    assert len(cdb) == 1000
+    os.remove(file_path)
+
+def test_get_many_from_list(cdb_file):
+    cdb = Cdb.open(cdb_file)
+    result = cdb.get_many([b"key1", b"missing", None, b"anotherkey"])
+    assert len(result) == 4
+    assert result.to_pylist() == [b"value1", None, None, b"anothervalue"]
+    assert result[0] == b"value1"
+    assert result[-1] == b"anothervalue"
+    assert result[1] is None
+    assert result.null_count == 2
+    assert result.values == b"value1anothervalue"
+    assert result.offsets == struct.pack("<5q", 0, 6, 6, 6, 18)
+    assert result.validity == bytes([0b1001])
+
+def test_get_many_arrow_roundtrip(cdb_file):
+    pa = pytest.importorskip("pyarrow")
+    cdb = Cdb.open(cdb_file)
+    keys = pa.array([b"key2", None, b"nope", b"key1"], type=pa.binary())
+    result = pa.array(cdb.get_many(keys))
+    assert result.type == pa.large_binary()
+    assert result.to_pylist() == [b"value2", None, None, b"value1"]
+
+    sliced = pa.array(["x", "key1", "key2"], type=pa.large_string()).slice(1)
+    assert cdb.get_many(sliced).to_pylist() == [b"value1", b"value2"]
+
+def test_put_many_from_iterables():
+    file_path = "put_many.cdb"
+    writer = CdbWriter(file_path)
+    assert writer.put_many([(b"a", b"1"), (b"b", b"2")]) == 2
+    assert writer.put_many((b"key%d" % i, b"value%d" % i) for i in range(3000)) == 3000
+    assert writer.put_many({b"c": b"3"}.items()) == 1
+    with pytest.raises(TypeError):
+        writer.put_many([(b"d", "not bytes")])
+    writer.finalize()
+
+    cdb = Cdb.open(file_path)
+    assert len(cdb) == 3003
+    assert cdb[b"b"] == b"2"
+    assert cdb[b"key2999"] == b"value2999"
+    assert cdb[b"c"] == b"3"
+    os.remove(file_path)
+
+def test_writer_context_manager():
+    file_path = "context.cdb"
+    with CdbWriter(file_path) as writer:
+        writer.put(b"key", b"value")
+    assert Cdb.open(file_path)[b"key"] == b"value"
+
+    writer = CdbWriter(file_path)
+    with pytest.raises(RuntimeError):
+        with writer:
+            raise RuntimeError("abort")
+    # The writer was not finalized, so it still accepts records.
+    writer.put(b"key", b"value")
+    os.remove(file_path)
+
+def test_put_arrow():
+    pa = pytest.importorskip("pyarrow")
+    file_path = "put_arrow.cdb"
+    keys = pa.array([b"k%d" % i for i in range(100)], type=pa.binary())
+    values = pa.array(["v%d" % i for i in range(100)], type=pa.large_string())
+    with CdbWriter(file_path) as writer:
+        assert writer.put_arrow(keys, values) == 100
+        with pytest.raises(ValueError):
+            writer.put_arrow(keys.slice(1), values)
+        with pytest.raises(ValueError):
+            writer.put_arrow(pa.array([b"x", None]), pa.array([b"1", b"2"]))
+        with pytest.raises(TypeError):
+            writer.put_arrow([b"x"], [b"1"])
+
+    cdb = Cdb.open(file_path)
+    assert len(cdb) == 100
+    assert cdb[b"k42"] == b"v42"
+    os.remove(file_path)
+
+def test_aget(cdb_file):
+    import asyncio
+    cdb = Cdb.open(cdb_file)
+
+    async def lookups():
+        values = await asyncio.gather(*(cdb.aget(k) for k in [b"key1", b"missing", b"key2"]))
+        many = await cdb.aget_many([b"anotherkey", None, b"key1"])
+        return values, many.to_pylist()
+
+    values, many = asyncio.run(lookups())
+    assert values == [b"value1", None, b"value2"]
+    assert many == [b"anothervalue", None, b"value1"]
+
+def test_aget_cancelled_and_outside_loop(cdb_file):
+    import asyncio
+    cdb = Cdb.open(cdb_file)
+
+    async def cancel():
+        future = cdb.aget(b"key1")
+        future.cancel()
+        # The lookup still completes on the pool; resolving must not raise.
+        await asyncio.sleep(0.05)
+        return await cdb.aget(b"key2")
+
+    assert asyncio.run(cancel()) == b"value2"
+    with pytest.raises(RuntimeError):
+        cdb.aget(b"key1")
+
+@pytest.mark.parametrize("mmap", [False, True])
+def test_pickle_reopens_by_path(cdb_file, mmap):
+    import pickle
+    cdb = Cdb(cdb_file, mmap=mmap)
+    assert cdb.path == cdb_file
+    clone = pickle.loads(pickle.dumps(cdb))
+    assert isinstance(clone, Cdb)
+    assert clone[b"key2"] == b"value2"
+    if mmap:
+        assert bytes(clone.get_view(b"key1")) == b"value1"
+    else:
+        with pytest.raises(ValueError):
+            clone.get_view(b"key1")
+
+@pytest.mark.skipif(not hasattr(os, "fork"), reason="requires os.fork")
+def test_mmap_handle_reused_after_fork(cdb_file):
+    cdb = Cdb.open_mmap(cdb_file)
+    assert cdb[b"key1"] == b"value1"
+
+    children = []
+    for _ in range(4):
+        pid = os.fork()
+        if pid == 0:
+            # Child: use the inherited handle and mapping without reopening.
+            ok = (
+                cdb[b"key1"] == b"value1"
+                and bytes(cdb.get_view(b"anotherkey")) == b"anothervalue"
+                and len(list(cdb.items())) == 3
+            )
+            os._exit(0 if ok else 1)
+        children.append(pid)
+    for pid in children:
+        _, status = os.waitpid(pid, 0)
+        assert os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
@@ -0,0 +1,52 @@
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+import pytest
+from cdb64_python import CdbWriter, Cdb
+
+NUM_RECORDS = 20_000
+LOOKUP_ROUNDS = 5
+
+
+@pytest.fixture(scope="module")
+def large_cdb_file(tmp_path_factory):
+    file_path = str(tmp_path_factory.mktemp("threading") / "threading.cdb")
+    writer = CdbWriter(file_path)
+    for i in range(NUM_RECORDS):
+        writer.put(b"key%d" % i, b"value%d" % i * 8)
+    writer.finalize()
+    yield file_path
+    os.remove(file_path)
+
+
+def lookup_range(cdb, start, stop):
+    found = 0
+    for _ in range(LOOKUP_ROUNDS):
+        for i in range(start, stop):
+            if cdb.get(b"key%d" % i) is not None:
+                found += 1
+    return found
+
+
+def run_lookups(cdb, num_threads):
+    chunk = NUM_RECORDS // num_threads
+    bounds = [(t * chunk, NUM_RECORDS if t == num_threads - 1 else (t + 1) * chunk) for t in range(num_threads)]
+    with ThreadPoolExecutor(max_workers=num_threads) as pool:
+        return sum(pool.map(lambda b: lookup_range(cdb, *b), bounds))
+
+
+def test_concurrent_lookups_are_consistent(large_cdb_file):
+    cdb = Cdb.open(large_cdb_file)
+    with ThreadPoolExecutor(max_workers=8) as pool:
+        results = list(pool.map(lambda i: cdb.get(b"key%d" % i), range(0, NUM_RECORDS, 7)))
+    assert results == [b"value%d" % i * 8 for i in range(0, NUM_RECORDS, 7)]
+
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        scans = list(pool.map(lambda _: len(list(cdb.iter())), range(4)))
+    assert scans == [NUM_RECORDS] * 4
+
+
+@pytest.mark.parametrize("num_threads", [1, 2, 4, 8])
+def test_threaded_lookups_find_every_key(large_cdb_file, num_threads):
+    cdb = Cdb.open(large_cdb_file)
+    assert run_lookups(cdb, num_threads) == NUM_RECORDS * LOOKUP_ROUNDS